@@ -22,20 +22,128 @@
 #include <stdio.h>
 
 #include "string.h"
+#include "mem.h"
+
+#define AI_MAX_DEPTH 8
+
+// placeholders for steps which are not emitted yet
+#define AI_NEXT_BUILD -2
+#define AI_NEXT_CRAFT -3
 
 void ai_init(ai_t* ai)
 {
 	ai->name = NULL;
 	transform_init(&ai->inventory);
 	ai->building = -1;
+
+	ai->n_steps = 0;
+	ai->steps = NULL;
+	ai->n_reserve = 0;
 }
 
 void ai_exit(ai_t* ai)
 {
+	free(ai->steps);
 	transform_exit(&ai->inventory);
 	free(ai->name);
 }
 
+void ai_cache_init(ai_cache_t* a)
+{
+	a->epoch = -1;
+	a->version = 0;
+	a->n_mines = 0;
+	a->mines = NULL;
+	a->sale = -2;
+	a->has_home = 0;
+}
+
+void ai_cache_exit(ai_cache_t* a)
+{
+	free(a->mines);
+}
+
+static ai_cache_t* cache(character_t* c)
+{
+	ai_cache_t* a = &c->ai_cache;
+	world_t* w = c->w;
+
+	// staggered among bots
+	int epoch = (w->tick + c->o.uuid) / AI_CACHE_TTL;
+	if (a->epoch == epoch && a->version == w->version)
+		return a;
+
+	universe_t* u = w->universe;
+	if (a->mines == NULL)
+	{
+		a->n_mines = u->n_mines;
+		a->mines = CALLOC(uuid_t, a->n_mines);
+	}
+	for (size_t i = 0; i < a->n_mines; i++)
+		a->mines[i] = -2;
+	a->sale = -2;
+	a->has_home = 0;
+
+	a->epoch = epoch;
+	a->version = w->version;
+	return a;
+}
+
+building_t* ai_home(character_t* c)
+{
+	ai_cache_t* a = cache(c);
+	if (!a->has_home || a->home == NULL || a->home->o.uuid != c->hasBuilding)
+	{
+		a->home = building_get(&c->w->objects, c->hasBuilding);
+		a->has_home = 1;
+	}
+	return a->home;
+}
+
+mine_t* ai_mine(character_t* c, kindOf_mine_t* t)
+{
+	ai_cache_t* a = cache(c);
+	size_t i = t - c->w->universe->mines;
+	if (a->mines[i] == -2)
+	{
+		mine_t* m = world_findMine(c->w, c->o.x, c->o.y, t);
+		a->mines[i] = m == NULL ? -1 : m->o.uuid;
+		return m;
+	}
+	return mine_get(&c->w->objects, a->mines[i]);
+}
+
+building_t* ai_sale(character_t* c, char is_item, int id, float amount)
+{
+	ai_cache_t* a = cache(c);
+	if (a->sale != -2 && a->sale_is_item == is_item && a->sale_id == id)
+	{
+		if (a->sale == -1)
+			return NULL;
+		building_t* b = building_get(&c->w->objects, a->sale);
+		if (b != NULL && inventory_get(&b->inventory, is_item, id) >= amount)
+			return b;
+	}
+
+	building_t* b = world_findSale(c->w, c->o.x, c->o.y, is_item, id, amount);
+	a->sale_is_item = is_item;
+	a->sale_id = id;
+	a->sale = b == NULL ? -1 : b->o.uuid;
+	return b;
+}
+
+// go to the nearest mine of the given kind
+static void go_mine(character_t* c, kindOf_mine_t* t)
+{
+	mine_t* m = mine_get(&c->w->objects, c->go_o);
+	if (m != NULL && m->t == t)
+		return;
+
+	m = ai_mine(c, t);
+	if (m != NULL)
+		c->go_o = m->o.uuid;
+}
+
 void ai_load(ai_t* ai, const char* filename)
 {
 	FILE* f = fopen(filename, "r");
@@ -103,6 +211,149 @@ void ai_load(ai_t* ai, const char* filename)
 	fclose(f);
 }
 
+static int push_step(ai_t* ai, ai_step_t s)
+{
+	ai->steps = CREALLOC(ai->steps, ai_step_t, ai->n_steps+1);
+	ai->steps[ai->n_steps] = s;
+	return ai->n_steps++;
+}
+
+static void patch_steps(ai_t* ai, int first, int last, int mark, int idx)
+{
+	for (int i = first; i < last; i++)
+	{
+		ai_step_t* s = &ai->steps[i];
+		if (s->scale == mark) s->scale = idx;
+		if (s->owner == mark) s->owner = idx;
+	}
+}
+
+// emits the steps ai_get() would go through without buying anything,
+// and returns the last one (-1 if none)
+static int compile_get(ai_t* ai, universe_t* u, char is_item, int id,
+	float amount, float fixed, int scale, int owner, int depth)
+{
+	recipe_t* r = universe_recipe(u, is_item, id);
+	int first = ai->n_steps;
+
+	if (r->mine != NULL)
+	{
+		ai_step_t s = {AI_GATHER, is_item, id, amount, fixed, scale, owner, first, r->mine, NULL};
+		return push_step(ai, s);
+	}
+
+	// no step is emitted for what cannot be obtained
+	const char* name = is_item ? u->items[id].name : u->materials[id].name;
+	if (r->building == NULL)
+	{
+		fprintf(stderr, "%s: I do not know how to make %s\n", ai->name, name);
+		return -1;
+	}
+	if (depth > AI_MAX_DEPTH)
+	{
+		fprintf(stderr, "%s: %s needs more than %i intermediate steps\n", ai->name, name, AI_MAX_DEPTH);
+		return -1;
+	}
+
+	// gather what is needed before building the workshop
+	for (size_t i = 0; i < r->n_prep; i++)
+	{
+		requisite_t* q = &r->prep[i];
+		compile_get(ai, u, q->is_item, q->id, q->amount, q->fixed,
+			AI_NEXT_CRAFT, AI_NEXT_BUILD, depth+1);
+	}
+	ai_step_t b = {AI_BUILD, is_item, id, 0, 0, -1, AI_NEXT_CRAFT, first, NULL, r->building};
+	int build = push_step(ai, b);
+	patch_steps(ai, first, build, AI_NEXT_BUILD, build);
+
+	// gather the components and make it
+	transform_t* tr = r->make;
+	for (int i = 0; i < tr->n_req; i++)
+	{
+		component_t* p = &tr->req[i];
+		compile_get(ai, u, p->is_item, p->id, p->amount, 0,
+			AI_NEXT_CRAFT, AI_NEXT_CRAFT, depth+1);
+	}
+	ai_step_t c = {AI_CRAFT, is_item, id, amount, fixed, scale, owner, first, NULL, r->building};
+	int craft = push_step(ai, c);
+	patch_steps(ai, first, craft, AI_NEXT_CRAFT, craft);
+	return craft;
+}
+
+// whether every base component along the production chain, workshops
+// included, can be gathered
+static char reachable(universe_t* u, char is_item, int id, int depth)
+{
+	recipe_t* r = universe_recipe(u, is_item, id);
+	for (size_t i = 0; i < r->n_raw; i++)
+	{
+		component_t* p = &r->raw[i];
+		if (universe_recipe(u, p->is_item, p->id)->mine == NULL)
+			return 0;
+	}
+
+	if (depth > AI_MAX_DEPTH)
+		return 0;
+	for (size_t i = 0; i < r->n_buildings; i++)
+	{
+		transform_t* tr = &u->buildings[r->buildings[i]].build;
+		for (int j = 0; j < tr->n_req; j++)
+			if (!reachable(u, tr->req[j].is_item, tr->req[j].id, depth+1))
+				return 0;
+	}
+	return 1;
+}
+
+// no step is emitted for a component which cannot be reached, rather
+// than the first steps of a plan which would never complete
+static void compile_top(ai_t* ai, universe_t* u, component_t* p, int owner)
+{
+	if (!reachable(u, p->is_item, p->id, 0))
+	{
+		const char* name = p->is_item ? u->items[p->id].name : u->materials[p->id].name;
+		fprintf(stderr, "%s: I cannot gather everything %s needs\n", ai->name, name);
+		return;
+	}
+	compile_get(ai, u, p->is_item, p->id, p->amount, 0, -1, owner, 0);
+}
+
+void ai_compile(ai_t* ai, universe_t* u)
+{
+	free(ai->steps);
+	ai->n_steps = 0;
+	ai->steps = NULL;
+
+	// always have apples to eat
+	component_t apples = {MATERIAL, 1, 5};
+	compile_top(ai, u, &apples, -1);
+	ai->n_reserve = ai->n_steps;
+
+	// preliminary components
+	transform_t* tr = &ai->inventory;
+	for (int i = 0; i < tr->n_req; i++)
+	{
+		compile_top(ai, u, &tr->req[i], -1);
+	}
+
+	// building for job
+	int first = ai->n_steps;
+	if (ai->building >= 0)
+	{
+		kindOf_building_t* t = &u->buildings[ai->building];
+		for (int i = 0; i < t->build.n_req; i++)
+		{
+			compile_top(ai, u, &t->build.req[i], AI_NEXT_BUILD);
+		}
+		ai_step_t b = {AI_BUILD, 0, -1, 0, 0, -1, -1, first, NULL, t};
+		int build = push_step(ai, b);
+		patch_steps(ai, first, build, AI_NEXT_BUILD, build);
+	}
+
+	// job
+	ai_step_t j = {AI_JOB, 0, -1, 0, 0, -1, -1, first, NULL, NULL};
+	push_step(ai, j);
+}
+
 char ai_get(character_t* c, char is_item, int id, float amount, char keep)
 {
 	universe_t* u = c->w->universe;
@@ -115,19 +366,19 @@ char ai_get(character_t* c, char is_item, int id, float amount, char keep)
 	kindOf_mine_t* m = universe_mineFor(u, is_item, id);
 	if (m != NULL)
 	{
-		character_goMine(c, m);
+		go_mine(c, m);
 		return 1;
 	}
 
 	// if the current building cannot obtain the component, build one which can
-	building_t* b = building_get(&c->w->objects, c->hasBuilding);
+	building_t* b = ai_home(c);
 	transform_t* tr = b == NULL ? NULL : kindOf_building_canMake(b->t, is_item, id);
 	if (tr == NULL)
 	{
 		// do not replace the building
 		if (keep)
 		{
-			if (rand() % 60 != 0)
+			if (rng_int(&c->w->rng[RNG_AI], 60) != 0)
 				return 1;
 
 			float price = is_item ? u->items[id].price : u->materials[id].price;
@@ -140,7 +391,7 @@ char ai_get(character_t* c, char is_item, int id, float amount, char keep)
 			}
 
 			// try and buy it
-			building_t* b = world_findSale(c->w, c->o.x, c->o.y, is_item, id);
+			building_t* b = ai_sale(c, is_item, id, amount);
 			if (b == NULL)
 				return 1;
 
@@ -154,7 +405,8 @@ char ai_get(character_t* c, char is_item, int id, float amount, char keep)
 			return 1;
 		}
 
-		kindOf_building_t* b = universe_buildFor(u, is_item, id);
+		recipe_t* r = universe_recipe(u, is_item, id);
+		kindOf_building_t* b = r->building;
 		if (b == NULL)
 		{
 			const char* name = is_item ? u->items[id].name : u->materials[id].name;
@@ -162,28 +414,15 @@ char ai_get(character_t* c, char is_item, int id, float amount, char keep)
 			return 1;
 		}
 
-		// materials to be gather before building
-		transform_t total;
-		transform_init(&total);
-
-		// first, gather the non-base materials for the component
-		tr = kindOf_building_canMake(b, is_item, id);
-		for (int i = 0; i < tr->n_req; i++)
+		// gather the non-base materials for the component,
+		// then the materials for the building
+		for (size_t i = 0; i < r->n_prep; i++)
 		{
-			component_t* p = &tr->req[i];
-			if (universe_mineFor(u, p->is_item, p->id) == NULL)
-				transform_req(&total, p->is_item, p->id, p->amount*amount);
+			requisite_t* q = &r->prep[i];
+			if (ai_get(c, q->is_item, q->id, q->amount*amount + q->fixed, keep))
+				return 1;
 		}
 
-		// then, gather the materials for the building
-		transform_add(&total, &b->build, 1);
-
-		// do gather
-		char isreq = ai_getreq(c, &total, 1, keep);
-		transform_exit(&total);
-		if (isreq)
-			return 1;
-
 		// build
 		character_buildAuto(c, b);
 		return 1;
@@ -221,52 +460,52 @@ char ai_getreq(character_t* c, transform_t* tr, float amount, char keep)
 	return 0;
 }
 
-char ai_build(character_t* c, int id)
+// what is still needed for the given step
+static float remaining(character_t* c, ai_step_t* steps, int i)
 {
-	universe_t* u = c->w->universe;
-	kindOf_building_t* t = &u->buildings[id];
-
-	building_t* b = building_get(&c->w->objects, c->hasBuilding);
-	if (b != NULL && b->t == t)
-		return 0;
-
-	if (ai_getreq(c, &t->build, 1, 0))
-		return 1;
-
-	character_buildAuto(c, t);
-	return 1;
+	ai_step_t* s = &steps[i];
+	float n = 1;
+	if (s->scale >= 0)
+	{
+		n = remaining(c, steps, s->scale);
+		if (n < 0)
+			n = 0;
+	}
+	float target = s->amount * n + s->fixed;
+	return target - inventory_get(&c->inventory, s->is_item, s->id);
 }
 
-char ai_do(ai_t* ai, character_t* c)
+static char complete(character_t* c, ai_step_t* steps, int i)
 {
-	transform_t* tr = &ai->inventory;
-
-	// eat apples
-	float max = character_maxOfStatus(c, ST_STAMINA);
-	float threshold = max * 0.5;
-	if (c->statuses[ST_STAMINA] < threshold)
-	{
-		while (c->statuses[ST_STAMINA] < max && character_eat(c, 1));
-		return 1;
-	}
-	// ensures the AI always has apples to eat
-	if (ai_get(c, MATERIAL, 1, 5.0, 1))
+	ai_step_t* s = &steps[i];
+	if (s->owner >= 0 && complete(c, steps, s->owner))
 		return 1;
 
-	// get preliminary components
-	while (c->ai_data.step < tr->n_req)
+	if (s->kind == AI_GATHER || s->kind == AI_CRAFT)
+		return remaining(c, steps, i) <= 0;
+
+	if (s->kind == AI_BUILD)
 	{
-		component_t* p = &tr->req[c->ai_data.step];
-		if (ai_get(c, p->is_item, p->id, p->amount, 0))
+		building_t* b = ai_home(c);
+		if (b == NULL)
+			return 0;
+		if (b->t == s->building)
 			return 1;
-		else
-			c->ai_data.step++;
+		return s->id >= 0 && kindOf_building_canMake(b->t, s->is_item, s->id) != NULL;
 	}
 
-	// make building for job
-	if (ai->building >= 0 && ai_build(c, ai->building))
-		return 1;
-	building_t* b = building_get(&c->w->objects, c->hasBuilding);
+	return 0;
+}
+
+// make and sell for a living; this one is not compiled, since what
+// is needed depends on the item drawn at random for each work order
+// and on what is for sale; ai_get() never builds here, it only
+// gathers, buys, or makes at home what home can make
+static char ai_job(character_t* c)
+{
+	transform_t* tr;
+
+	building_t* b = ai_home(c);
 	if (b == NULL)
 	{
 		fprintf(stderr, "Where did my house go? :(\n");
@@ -291,7 +530,7 @@ char ai_do(ai_t* ai, character_t* c)
 			if (c->ai_data.sell > 0)
 				building_put(b, ITEM, c->ai_data.sell-1, 1.0, &c->inventory, 1);
 
-			int nth = rand() % n;
+			int nth = rng_int(&c->w->rng[RNG_AI], n);
 			building_work_enqueue(b, nth);
 			c->ai_data.collect = 1;
 			c->ai_data.sell = b->t->items[nth].res[0].id + 1;
@@ -337,3 +576,98 @@ char ai_do(ai_t* ai, character_t* c)
 
 	return 1;
 }
+
+static char run_step(character_t* c, ai_step_t* s)
+{
+	if (s->kind == AI_GATHER)
+	{
+		if (s->mine != NULL)
+			go_mine(c, s->mine);
+		return 1;
+	}
+	else if (s->kind == AI_BUILD)
+	{
+		character_buildAuto(c, s->building);
+		return 1;
+	}
+	else if (s->kind == AI_CRAFT)
+	{
+		building_t* b = ai_home(c);
+		if (b == NULL)
+			return 1;
+
+		// go in the building
+		if (c->inBuilding != c->hasBuilding)
+		{
+			character_goto(c, b->o.uuid);
+			return 1;
+		}
+
+		// enqueue item
+		transform_t* tr = kindOf_building_canMake(b->t, s->is_item, s->id);
+		if (s->is_item && tr != NULL && b->work_n == 0)
+		{
+			int nth = tr - b->t->items;
+			building_work_enqueue(b, nth);
+		}
+
+		// work
+		return 1;
+	}
+
+	return ai_job(c);
+}
+
+char ai_run(ai_t* ai, character_t* c)
+{
+	if (ai->n_steps == 0)
+		return 0;
+
+	ai_step_t* steps = ai->steps;
+	int n = ai->n_steps;
+
+	// stocks first, prerequisites coming before what they are for
+	int start = ai->n_reserve;
+	for (int i = 0; i < start; i++)
+		if (!complete(c, steps, i))
+			return run_step(c, &steps[i]);
+
+	int pc = c->ai_data.pc;
+	if (pc < start || pc >= n)
+		pc = start;
+
+	// skip completed steps and go back to the first one which
+	// has been undone since (e.g. components consumed or sold)
+	while (1)
+	{
+		while (pc < n-1 && complete(c, steps, pc))
+			pc++;
+
+		int top = pc;
+		while (steps[top].owner >= 0)
+			top = steps[top].owner;
+
+		int i = steps[top].first;
+		while (i < pc && complete(c, steps, i))
+			i++;
+		if (i == pc)
+			break;
+		pc = i;
+	}
+	c->ai_data.pc = pc;
+
+	return run_step(c, &steps[pc]);
+}
+
+char ai_do(ai_t* ai, character_t* c)
+{
+	// eat apples
+	float max = character_maxOfStatus(c, ST_STAMINA);
+	float threshold = max * 0.5;
+	if (c->statuses[ST_STAMINA] < threshold)
+	{
+		while (c->statuses[ST_STAMINA] < max && character_eat(c, 1));
+		return 1;
+	}
+	return ai_run(ai, c);
+}
@@ -19,23 +19,87 @@
 #ifndef U_AI_H
 #define U_AI_H
 
+typedef struct ai_step ai_step_t;
 typedef struct ai      ai_t;
 typedef struct ai_data ai_data_t;
+typedef struct ai_cache ai_cache_t;
+
+#include <sys/types.h>
 
 #include "universe/transform.h"
+#include "world/object.h"
+
+#define AI_GATHER 0 // go to a mine
+#define AI_BUILD  1 // build a new home
+#define AI_CRAFT  2 // make a component at home
+#define AI_JOB    3 // make and sell for a living
+
+// rounds between two refreshes of the perception cache
+#define AI_CACHE_TTL 64
+
+struct kindOf_mine;
+struct kindOf_building;
+struct mine;
+struct building;
+struct character;
+
+struct ai_step
+{
+	char kind;
+
+	char is_item;
+	int  id;
+
+	// the amount to get is 'amount' times what is still
+	// needed for step 'scale' (one if negative) plus 'fixed'
+	float amount;
+	float fixed;
+	int   scale;
+
+	int owner; // step this one is a prerequisite of
+	int first; // first prerequisite of this step
+
+	struct kindOf_mine*     mine;
+	struct kindOf_building* building;
+};
 
 struct ai
 {
 	char*       name;
 	transform_t inventory;
 	int         building;
+
+	// plan compiled from the above; the first 'n_reserve' steps
+	// keep stocks (food) and come before any other
+	size_t     n_steps;
+	ai_step_t* steps;
+	size_t     n_reserve;
 };
 
 struct ai_data
 {
-	int step;
+	int pc;      // current step
 	int collect; // need materials for item
 	int sell;    // 0: ignore, other put item (id+1) for sell
+	float idle;  // time since last decision
+};
+
+// answers to world queries, dropped every AI_CACHE_TTL rounds (at a
+// different round for each bot) or when objects are added or removed
+struct ai_cache
+{
+	int          epoch;
+	unsigned int version;
+
+	size_t  n_mines;
+	uuid_t* mines; // nearest mine of each kind, -2 when unknown
+
+	char   sale_is_item;
+	int    sale_id;
+	uuid_t sale; // last seller found, -2 when unknown
+
+	char             has_home;
+	struct building* home;
 };
 
 #include "world/character.h"
@@ -45,11 +109,20 @@ void ai_exit(ai_t* ai);
 
 void ai_push_item(ai_t* ai, int id);
 
-void ai_load(ai_t* ai, const char* filename);
+void ai_cache_init(ai_cache_t* a);
+void ai_cache_exit(ai_cache_t* a);
+
+// cached world queries
+struct building* ai_home (character_t* c);
+struct mine*     ai_mine (character_t* c, struct kindOf_mine* t);
+struct building* ai_sale (character_t* c, char is_item, int id, float amount);
+
+void ai_load   (ai_t* ai, const char* filename);
+void ai_compile(ai_t* ai, universe_t* u);
 
 char ai_get   (character_t* c, char is_item, int id, float amount, char keep);
 char ai_getreq(character_t* c, transform_t* tr,      float amount, char keep);
-char ai_build (character_t* c, int id);
+char ai_run   (ai_t* ai, character_t* c);
 char ai_do    (ai_t* ai, character_t* c);
 
 #endif
@@ -0,0 +1,137 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "batch.h"
+
+#include <stdlib.h>
+
+#include "mem.h"
+#include "math.h"
+
+void batch_init(batch_t* b)
+{
+	b->n_layers = 0;
+	b->a_layers = 0;
+	b->layers = NULL;
+	b->shapes = (layer_t){NULL, 0, 0, NULL};
+	b->n_calls = 0;
+}
+
+void batch_exit(batch_t* b)
+{
+	for (size_t i = 0; i < b->a_layers; i++)
+		free(b->layers[i].vertices);
+	free(b->layers);
+	free(b->shapes.vertices);
+}
+
+static layer_t* layer(batch_t* b, const sfTexture* t)
+{
+	// consecutive sprites mostly share their texture
+	for (size_t i = b->n_layers; i > 0; i--)
+		if (b->layers[i-1].texture == t)
+			return &b->layers[i-1];
+
+	if (b->n_layers == b->a_layers)
+	{
+		size_t a = b->a_layers ? 2*b->a_layers : 8;
+		b->layers = CREALLOC(b->layers, layer_t, a);
+		for (size_t i = b->a_layers; i < a; i++)
+			b->layers[i] = (layer_t){NULL, 0, 0, NULL};
+		b->a_layers = a;
+	}
+
+	// the vertices of an emptied layer are kept for the next texture
+	layer_t* l = &b->layers[b->n_layers++];
+	l->texture = t;
+	l->n_vertices = 0;
+	return l;
+}
+
+static sfVertex* quad(layer_t* l)
+{
+	if (l->n_vertices + 4 > l->a_vertices)
+	{
+		l->a_vertices = l->a_vertices ? 2*l->a_vertices : 256;
+		l->vertices = CREALLOC(l->vertices, sfVertex, l->a_vertices);
+	}
+	sfVertex* v = &l->vertices[l->n_vertices];
+	l->n_vertices += 4;
+	return v;
+}
+
+void batch_sprite(batch_t* b, const sfTexture* t, sfIntRect rect, sfVector2f pos, sfColor color)
+{
+	sfVertex* v = quad(layer(b, t));
+	float x = pos.x;
+	float y = pos.y;
+	float w = rect.width;
+	float h = rect.height;
+	float u = rect.left;
+	float s = rect.top;
+	v[0] = (sfVertex){{x,   y  }, color, {u,   s  }};
+	v[1] = (sfVertex){{x+w, y  }, color, {u+w, s  }};
+	v[2] = (sfVertex){{x+w, y+h}, color, {u+w, s+h}};
+	v[3] = (sfVertex){{x,   y+h}, color, {u,   s+h}};
+}
+
+void batch_rect(batch_t* b, float x, float y, float w, float h, sfColor color)
+{
+	if (w <= 0 || h <= 0)
+		return;
+	sfVertex* v = quad(&b->shapes);
+	v[0] = (sfVertex){{x,   y  }, color, {0,0}};
+	v[1] = (sfVertex){{x+w, y  }, color, {0,0}};
+	v[2] = (sfVertex){{x+w, y+h}, color, {0,0}};
+	v[3] = (sfVertex){{x,   y+h}, color, {0,0}};
+}
+
+void batch_ring(batch_t* b, float x, float y, float rx, float ry, float thickness, sfColor color)
+{
+	static const int n = 30;
+	for (int k = 0; k < n; k++)
+	{
+		float a0 = 2 * M_PI * k     / n;
+		float a1 = 2 * M_PI * (k+1) / n;
+		float t = thickness;
+		float s = thickness * ry / rx;
+		sfVertex* v = quad(&b->shapes);
+		v[0] = (sfVertex){{x + rx    *cosf(a0), y + ry    *sinf(a0)}, color, {0,0}};
+		v[1] = (sfVertex){{x + rx    *cosf(a1), y + ry    *sinf(a1)}, color, {0,0}};
+		v[2] = (sfVertex){{x + (rx+t)*cosf(a1), y + (ry+s)*sinf(a1)}, color, {0,0}};
+		v[3] = (sfVertex){{x + (rx+t)*cosf(a0), y + (ry+s)*sinf(a0)}, color, {0,0}};
+	}
+}
+
+static void draw(batch_t* b, sfRenderWindow* render, layer_t* l)
+{
+	if (l->n_vertices == 0)
+		return;
+	sfRenderStates states = {sfBlendAlpha, {{1,0,0,0,1,0,0,0,1}}, l->texture, NULL};
+	sfRenderWindow_drawPrimitives(render, l->vertices, l->n_vertices, sfQuads, &states);
+	l->n_vertices = 0;
+	b->n_calls++;
+}
+
+void batch_flush(batch_t* b, sfRenderWindow* render)
+{
+	for (size_t i = 0; i < b->n_layers; i++)
+		draw(b, render, &b->layers[i]);
+	draw(b, render, &b->shapes);
+	b->n_layers = 0;
+}
@@ -0,0 +1,56 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <SFML/Graphics.h>
+
+// quads gathered by texture, so as to draw each texture in one call
+typedef struct
+{
+	const sfTexture* texture; // NULL for plain colors
+	size_t n_vertices;
+	size_t a_vertices;
+	sfVertex* vertices;
+} layer_t;
+
+typedef struct
+{
+	size_t   n_layers;
+	size_t   a_layers;
+	layer_t* layers;
+	layer_t  shapes; // drawn over the textures
+
+	size_t n_calls; // draw calls of the batch since the last FPS measure
+} batch_t;
+
+void batch_init(batch_t* b);
+void batch_exit(batch_t* b);
+
+// a part of a texture at some position, a plain rectangle, or the
+// outline of an ellipse centered at (x,y), thickness along x
+void batch_sprite(batch_t* b, const sfTexture* t, sfIntRect rect, sfVector2f pos, sfColor color);
+void batch_rect  (batch_t* b, float x, float y, float w, float h, sfColor color);
+void batch_ring  (batch_t* b, float x, float y, float rx, float ry, float thickness, sfColor color);
+
+// draw the textures in order of first use, then the shapes, and empty
+// the batch; painter's order is only kept between flushes
+void batch_flush(batch_t* b, sfRenderWindow* render);
+
+#endif
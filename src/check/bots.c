@@ -0,0 +1,165 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+// compiles the plan of every bot and checks its steps against the
+// recipes, then times the compilation; run from the game directory
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../game.h"
+#include "../jobs.h"
+
+#define MAX_DEPTH 8 // as in ai.c
+#define N_RUNS    100
+
+// whether every base component of the chain can be gathered
+static char reachable(universe_t* u, char is_item, int id, int depth)
+{
+	recipe_t* r = universe_recipe(u, is_item, id);
+	for (size_t i = 0; i < r->n_raw; i++)
+		if (universe_recipe(u, r->raw[i].is_item, r->raw[i].id)->mine == NULL)
+			return 0;
+	if (depth > MAX_DEPTH)
+		return 0;
+	for (size_t i = 0; i < r->n_buildings; i++)
+	{
+		transform_t* tr = &u->buildings[r->buildings[i]].build;
+		for (int j = 0; j < tr->n_req; j++)
+			if (!reachable(u, tr->req[j].is_item, tr->req[j].id, depth+1))
+				return 0;
+	}
+	return 1;
+}
+
+// gather, or gather for the workshop, build it, gather and craft
+static size_t count(universe_t* u, char is_item, int id, int depth)
+{
+	recipe_t* r = universe_recipe(u, is_item, id);
+	if (r->mine != NULL)
+		return 1;
+	if (r->building == NULL || depth > MAX_DEPTH)
+		return 0;
+
+	size_t n = 2;
+	for (size_t i = 0; i < r->n_prep; i++)
+		n += count(u, r->prep[i].is_item, r->prep[i].id, depth+1);
+	for (int i = 0; i < r->make->n_req; i++)
+		n += count(u, r->make->req[i].is_item, r->make->req[i].id, depth+1);
+	return n;
+}
+
+static size_t count_top(universe_t* u, component_t* p)
+{
+	return reachable(u, p->is_item, p->id, 0) ? count(u, p->is_item, p->id, 0) : 0;
+}
+
+static size_t expected(universe_t* u, ai_t* ai)
+{
+	component_t apples = {MATERIAL, 1, 5};
+	size_t n = count_top(u, &apples);
+
+	for (int i = 0; i < ai->inventory.n_req; i++)
+		n += count_top(u, &ai->inventory.req[i]);
+
+	if (ai->building >= 0)
+	{
+		transform_t* tr = &u->buildings[ai->building].build;
+		for (int i = 0; i < tr->n_req; i++)
+			n += count_top(u, &tr->req[i]);
+		n++;
+	}
+
+	return n + 1; // job
+}
+
+// steps only refer to later ones, and have what they need to run
+static const char* malformed(ai_t* ai)
+{
+	int n = ai->n_steps;
+	if (n == 0 || ai->steps[n-1].kind != AI_JOB)
+		return "the last step is not the job";
+	if (ai->n_reserve >= ai->n_steps)
+		return "there are only reserve steps";
+
+	for (int i = 0; i < n; i++)
+	{
+		ai_step_t* s = &ai->steps[i];
+		if (s->owner >= 0 && !(i < s->owner && s->owner < n))
+			return "a step is a prerequisite of an earlier one";
+		if (s->scale >= 0 && !(i < s->scale && s->scale < n))
+			return "a step is scaled by an earlier one";
+		if (!(0 <= s->first && s->first <= i))
+			return "a step starts after itself";
+		if ((size_t) i < ai->n_reserve && s->owner >= (int) ai->n_reserve)
+			return "a reserve step is for a later one";
+		if (s->kind == AI_GATHER && s->mine == NULL)
+			return "a gathering step has no mine";
+		if ((s->kind == AI_BUILD || s->kind == AI_CRAFT) && s->building == NULL)
+			return "a building step has no building";
+	}
+	return NULL;
+}
+
+int main(void)
+{
+	jobs_init(0);
+	assets_t a;
+	assets_init(&a);
+
+	// plans are compiled when the universe is loaded
+	settings_t s = {.verbosity = 0};
+	game_t g = {.s = &s, .a = &a};
+	universe_t u;
+	g.u = &u;
+	universe_init(&u, &g);
+
+	int ret = 0;
+	size_t n_steps = 0;
+	for (size_t i = 0; i < u.n_bots; i++)
+	{
+		ai_t* ai = &u.bots[i];
+		size_t n = expected(&u, ai);
+		const char* error = malformed(ai);
+		if (ai->n_steps != n)
+		{
+			fprintf(stderr, "%s: %u steps instead of %u\n", ai->name, (unsigned) ai->n_steps, (unsigned) n);
+			ret = 1;
+		}
+		else if (error != NULL)
+		{
+			fprintf(stderr, "%s: %s\n", ai->name, error);
+			ret = 1;
+		}
+		n_steps += ai->n_steps;
+	}
+	fprintf(stderr, "Checked %u bots, %u steps\n", (unsigned) u.n_bots, (unsigned) n_steps);
+
+	clock_t start = clock();
+	for (int k = 0; k < N_RUNS; k++)
+		for (size_t i = 0; i < u.n_bots; i++)
+			ai_compile(&u.bots[i], &u);
+	double elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+	fprintf(stderr, "Compiled all bots in %.1f µs\n", 1e6 * elapsed / N_RUNS);
+
+	universe_exit(&u);
+	assets_exit(&a);
+	jobs_exit();
+	return ret;
+}
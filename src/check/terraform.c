@@ -0,0 +1,98 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+// changing the type of a tile and changing it back must give the same
+// lands, borders included; run from the game directory
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../game.h"
+#include "../jobs.h"
+
+static int check(assets_t* a, int generator)
+{
+	settings_t s =
+	{
+		.seed       = 42,
+		.map_width  = 200,
+		.map_height = 200,
+		.generator  = generator,
+		.map_cache  = MAP_CACHE_OFF,
+	};
+
+	// no overlay, which needs a window
+	game_t g = {.s = &s, .a = a};
+	universe_t u;
+	world_t w;
+	g.u = &u;
+	g.w = &w;
+	universe_init(&u, &g);
+	world_init(&w, &g);
+	w.rows = s.map_height;
+	w.cols = s.map_width;
+	if (!world_genmap(&w, s.seed))
+	{
+		fprintf(stderr, "Generator %i: could not generate the map\n", generator);
+		world_exit(&w);
+		universe_exit(&u);
+		return 1;
+	}
+
+	int n_tiles = 0;
+	int n_failed = 0;
+	for (int i = 1; i+1 < w.rows; i += 7)
+		for (int j = 1; j+1 < w.cols; j += 5)
+		{
+			short before[9];
+			for (int k = 0; k < 9; k++)
+				before[k] = world_getLandIJ(&w, i-1+k/3, j-1+k%3);
+
+			short t = before[4] / 16;
+			world_setTypeIJ(&w, i, j, t == 10 ? 0 : 10);
+			world_setTypeIJ(&w, i, j, t);
+
+			for (int k = 0; k < 9; k++)
+				if (world_getLandIJ(&w, i-1+k/3, j-1+k%3) != before[k])
+				{
+					n_failed++;
+					break;
+				}
+			n_tiles++;
+		}
+
+	fprintf(stderr, "Generator %i: %i of %i tiles changed back differently\n", generator, n_failed, n_tiles);
+	world_exit(&w);
+	universe_exit(&u);
+	return n_failed != 0;
+}
+
+int main(void)
+{
+	jobs_init(0);
+	assets_t a;
+	assets_init(&a);
+
+	int ret = 0;
+	for (int generator = WORLD_GEN_VORONOI; generator <= WORLD_GEN_NOISE; generator++)
+		ret |= check(&a, generator);
+
+	assets_exit(&a);
+	jobs_exit();
+	return ret;
+}
@@ -35,3 +35,23 @@ char isdir(const char* path)
 	}
 	return S_ISDIR(info.st_mode);
 }
+
+char makedir(const char* path)
+{
+	struct stat info;
+	if (stat(path, &info) == 0)
+		return S_ISDIR(info.st_mode);
+#ifdef __WIN32__
+	return mkdir(path) == 0;
+#else
+	return mkdir(path, 0755) == 0;
+#endif
+}
+
+time_t mtime(const char* path)
+{
+	struct stat info;
+	if (stat(path, &info) < 0)
+		return 0;
+	return info.st_mtime;
+}
@@ -40,10 +40,17 @@ enum
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <dirent.h>
 
 char isdir(const char* path);
 
+// creates a directory unless it exists; returns 0 on failure
+char makedir(const char* path);
+
+// time of last modification, 0 if unknown
+time_t mtime(const char* path);
+
 // executes DO for every entry in the given directory
 // in DO, 'path' points to the current entry
 #define FOREACH_ALL(PATH, DO) do { \
@@ -30,7 +30,7 @@
 #include "world/load.h"
 #include "overlay/overlay.h"
 
-void game_init(game_t* g, settings_t* s, graphics_t* gr, assets_t* a, char load)
+void game_prepare(game_t* g, settings_t* s, graphics_t* gr, assets_t* a)
 {
 	g->s = s;
 	g->g = gr;
@@ -48,7 +48,12 @@ void game_init(game_t* g, settings_t* s, graphics_t* gr, assets_t* a, char load)
 	   world_init(g->w, g);
 
 	g->fps  = 0;
+	g->started = 0;
+}
 
+char game_generate(game_t* g, char load)
+{
+	settings_t* s = g->s;
 	if (load)
 	{
 		game_load(g, "game.save");
@@ -57,9 +62,19 @@ void game_init(game_t* g, settings_t* s, graphics_t* gr, assets_t* a, char load)
 	{
 		g->w->rows = s->map_height;
 		g->w->cols = s->map_width;
-		world_genmap(g->w, s->seed);
+		if (!world_genmap(g->w, s->seed))
+			return 0;
+		if (!progress_set(g->w->progress, PROGRESS_CHARACTERS, 0))
+			return 0;
 		world_start(g->w);
 	}
+	return !progress_cancelled(g->w->progress) && progress_error(g->w->progress) == NULL;
+}
+
+void game_start(game_t* g, char load)
+{
+	settings_t* s = g->s;
+	g->started = 1;
 
 	sfVector2u size = sfRenderWindow_getSize(g->g->render);
 	sfFloatRect rect = {0,0,size.x,size.y};
@@ -78,7 +93,7 @@ void game_init(game_t* g, settings_t* s, graphics_t* gr, assets_t* a, char load)
 		if (g->player == NULL)
 			g->player = c;
 		else if (!load)
-			c->ai = &g->u->bots[rand() % g->u->n_bots];
+			c->ai = &g->u->bots[rng_int(&g->w->rng[RNG_CHARACTERS], g->u->n_bots)];
 	}
 	if (g->player == NULL)
 	{
@@ -107,8 +122,11 @@ void game_init(game_t* g, settings_t* s, graphics_t* gr, assets_t* a, char load)
 
 void game_exit(game_t* g)
 {
-	sfView_destroy(g->g->overlay_view);
-	sfView_destroy(g->g->world_view);
+	if (g->started)
+	{
+		sfView_destroy(g->g->overlay_view);
+		sfView_destroy(g->g->world_view);
+	}
 
 	   world_exit(g->w);
 	universe_exit(g->u);
@@ -133,6 +151,7 @@ void game_loop(game_t* g)
 	int   fpscount = 0;
 	float fpssum   = 0;
 	float fpslast  = 0;
+	g->g->batch.n_calls = 0;
 
 	char stayhere = 1;
 	while (stayhere && sfRenderWindow_isOpen(g->g->render))
@@ -373,6 +392,9 @@ void game_loop(game_t* g)
 		if (fpslast >= 1.)
 		{
 			g->fps = fpssum / fpscount;
+			if (g->s->verbosity >= 3)
+				fprintf(stderr, "%.0f FPS, %.1f batched draw calls per frame\n", g->fps, (float) g->g->batch.n_calls / fpscount);
+			g->g->batch.n_calls = 0;
 			fpscount = 0;
 			fpssum = 0;
 			fpslast = 0;
@@ -388,6 +410,7 @@ void game_loop(game_t* g)
 		}
 
 		// do round
+		aisched_focus(&g->w->sched, c->o.x, c->o.y);
 		overlay_doRound(g,    duration);
 		  world_doRound(g->w, duration);
 	}
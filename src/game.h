@@ -42,10 +42,19 @@ struct game
 
 	character_t* player;
 	char         autoEat[N_STATUSES];
+
+	char started; // game_start() was called
 };
 
-void game_init(game_t* g, settings_t* s, graphics_t* gr, assets_t* a, char load);
 void game_exit(game_t* g);
+
+// a game starts in three steps, so that the world can be generated on another
+// thread; game_generate() returns 0 when cancelled through w->progress,
+// or when generation failed (see progress_error()), and game_start() must
+// then not be called
+void game_prepare (game_t* g, settings_t* s, graphics_t* gr, assets_t* a);
+char game_generate(game_t* g, char load);
+void game_start   (game_t* g, char load);
 void game_loop(game_t* g);
 
 void game_save(game_t* g, const char* filename);
@@ -29,10 +29,12 @@ void graphics_init(graphics_t* g)
 	if (g->render == NULL)
 		exit(1);
 	sfRenderWindow_setMouseCursorVisible(g->render, sfFalse);
+	batch_init(&g->batch);
 }
 
 void graphics_exit(graphics_t* g)
 {
+	batch_exit(&g->batch);
 	sfRenderWindow_destroy(g->render);
 }
 
@@ -21,6 +21,8 @@
 
 #include <SFML/Graphics.h>
 
+#include "batch.h"
+
 typedef struct graphics graphics_t;
 
 struct graphics
@@ -29,6 +31,9 @@ struct graphics
 
 	sfView* world_view;
 	sfView* overlay_view;
+
+	// sprites of the world, drawn by texture
+	batch_t batch;
 };
 
 void graphics_init(graphics_t* g);
@@ -0,0 +1,395 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "jobs.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef __WIN32__
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "mem.h"
+
+#define JOBS_MAX_THREADS 64
+#define JOBS_STATS       32 // distinct job names that are timed
+
+struct job
+{
+	const char* name;
+	job_func_t  func;
+	void*       arg;
+	wgroup_t*   group;
+	job_t*      next; // in a waiting list
+};
+
+// ring buffer of jobs
+typedef struct
+{
+	sfMutex* mutex;
+	job_t**  jobs;
+	size_t   size;
+	size_t   head; // oldest job
+	size_t   count;
+} deque_t;
+
+typedef struct
+{
+	const char* name;
+	size_t count;
+	long long total;   // in microseconds
+	long long longest;
+} jobstat_t;
+
+static struct
+{
+	int       n_workers;
+	sfThread* threads[JOBS_MAX_THREADS];
+	size_t    n_deques;
+	deque_t   deques[JOBS_MAX_THREADS];
+
+	sfMutex* mutex; // for what follows
+	size_t   next;  // deque of the next job pushed
+	char     stop;
+	sfClock* clock;
+	size_t    n_stats;
+	jobstat_t stats[JOBS_STATS];
+} pool;
+
+static int cores(void)
+{
+#ifdef __WIN32__
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n < 1 ? 1 : n;
+#endif
+}
+
+static void deque_push(deque_t* d, job_t* j)
+{
+	sfMutex_lock(d->mutex);
+	if (d->count == d->size)
+	{
+		size_t size = d->size == 0 ? 64 : 2*d->size;
+		job_t** jobs = CALLOC(job_t*, size);
+		for (size_t k = 0; k < d->count; k++)
+			jobs[k] = d->jobs[(d->head + k) % d->size];
+		free(d->jobs);
+		d->jobs = jobs;
+		d->size = size;
+		d->head = 0;
+	}
+	d->jobs[(d->head + d->count) % d->size] = j;
+	d->count++;
+	sfMutex_unlock(d->mutex);
+}
+
+// the newest job for the owner, the oldest one for thieves
+static job_t* deque_pop(deque_t* d, char newest)
+{
+	job_t* j = NULL;
+	sfMutex_lock(d->mutex);
+	if (d->count > 0)
+	{
+		if (newest)
+		{
+			j = d->jobs[(d->head + d->count-1) % d->size];
+		}
+		else
+		{
+			j = d->jobs[d->head];
+			d->head = (d->head + 1) % d->size;
+		}
+		d->count--;
+	}
+	sfMutex_unlock(d->mutex);
+	return j;
+}
+
+// from its own deque first, then from the others; threads
+// which are not workers use self = n_deques
+static job_t* take(size_t self)
+{
+	size_t n = pool.n_deques;
+	job_t* j = self < n ? deque_pop(&pool.deques[self], 1) : NULL;
+	for (size_t k = 1; j == NULL && k <= n; k++)
+		j = deque_pop(&pool.deques[(self+k) % n], 0);
+	return j;
+}
+
+static void schedule(job_t* j)
+{
+	sfMutex_lock(pool.mutex);
+	size_t k = pool.next++ % pool.n_deques;
+	sfMutex_unlock(pool.mutex);
+	deque_push(&pool.deques[k], j);
+}
+
+static long long now(void)
+{
+	return sfTime_asMicroseconds(sfClock_getElapsedTime(pool.clock));
+}
+
+static void stat_add(const char* name, long long time)
+{
+	sfMutex_lock(pool.mutex);
+	size_t k = 0;
+	while (k < pool.n_stats && strcmp(pool.stats[k].name, name) != 0)
+		k++;
+	if (k == pool.n_stats && k < JOBS_STATS)
+	{
+		pool.stats[k] = (jobstat_t){name, 0, 0, 0};
+		pool.n_stats++;
+	}
+	if (k < pool.n_stats)
+	{
+		jobstat_t* s = &pool.stats[k];
+		s->count++;
+		s->total += time;
+		if (time > s->longest)
+			s->longest = time;
+	}
+	sfMutex_unlock(pool.mutex);
+}
+
+static void run(job_t* j)
+{
+	long long start = now();
+	j->func(j->arg);
+	stat_add(j->name, now() - start);
+
+	wgroup_t* g = j->group;
+	free(j);
+	if (g == NULL)
+		return;
+
+	// the group may be freed as soon as it is unlocked
+	sfMutex_lock(g->mutex);
+	job_t* ready = NULL;
+	if (--g->pending == 0)
+	{
+		ready = g->waiting;
+		g->waiting = NULL;
+	}
+	sfMutex_unlock(g->mutex);
+
+	while (ready != NULL)
+	{
+		job_t* next = ready->next;
+		schedule(ready);
+		ready = next;
+	}
+}
+
+// yield at first, then sleep longer and longer
+static void backoff(int idle)
+{
+	int us = idle < 64 ? 0 : idle < 1024 ? 100 : idle < 4096 ? 1000 : 10000;
+	sfSleep(sfMicroseconds(us));
+}
+
+static char stopping(void)
+{
+	sfMutex_lock(pool.mutex);
+	char ret = pool.stop;
+	sfMutex_unlock(pool.mutex);
+	return ret;
+}
+
+static void worker(void* arg)
+{
+	size_t self = (deque_t*) arg - pool.deques;
+	int idle = 0;
+	while (1)
+	{
+		job_t* j = take(self);
+		if (j != NULL)
+		{
+			run(j);
+			idle = 0;
+		}
+		else if (stopping())
+			break;
+		else
+			backoff(idle++);
+	}
+}
+
+void jobs_init(int n_threads)
+{
+	if (n_threads <= 0)
+		n_threads = cores();
+	if (n_threads > JOBS_MAX_THREADS)
+		n_threads = JOBS_MAX_THREADS;
+
+	// the thread waiting for the jobs runs some too
+	pool.n_workers = n_threads - 1;
+	pool.n_deques = pool.n_workers > 0 ? pool.n_workers : 1;
+	pool.mutex = sfMutex_create();
+	pool.next = 0;
+	pool.stop = 0;
+	pool.clock = sfClock_create();
+	pool.n_stats = 0;
+	for (size_t k = 0; k < pool.n_deques; k++)
+		pool.deques[k] = (deque_t){sfMutex_create(), NULL, 0, 0, 0};
+	for (int k = 0; k < pool.n_workers; k++)
+	{
+		pool.threads[k] = sfThread_create(worker, &pool.deques[k]);
+		sfThread_launch(pool.threads[k]);
+	}
+}
+
+void jobs_exit(void)
+{
+	sfMutex_lock(pool.mutex);
+	pool.stop = 1;
+	sfMutex_unlock(pool.mutex);
+	for (int k = 0; k < pool.n_workers; k++)
+	{
+		sfThread_wait(pool.threads[k]);
+		sfThread_destroy(pool.threads[k]);
+	}
+	for (size_t k = 0; k < pool.n_deques; k++)
+	{
+		free(pool.deques[k].jobs);
+		sfMutex_destroy(pool.deques[k].mutex);
+	}
+	sfClock_destroy(pool.clock);
+	sfMutex_destroy(pool.mutex);
+}
+
+int jobs_threads(void)
+{
+	return pool.n_workers + 1;
+}
+
+void wgroup_init(wgroup_t* g)
+{
+	g->mutex = sfMutex_create();
+	g->pending = 0;
+	g->waiting = NULL;
+}
+
+void wgroup_exit(wgroup_t* g)
+{
+	sfMutex_destroy(g->mutex);
+}
+
+void wgroup_wait(wgroup_t* g)
+{
+	int idle = 0;
+	while (1)
+	{
+		sfMutex_lock(g->mutex);
+		size_t pending = g->pending;
+		sfMutex_unlock(g->mutex);
+		if (pending == 0)
+			return;
+
+		job_t* j = take(pool.n_deques);
+		if (j != NULL)
+		{
+			run(j);
+			idle = 0;
+		}
+		else
+			backoff(idle++);
+	}
+}
+
+void jobs_push(const char* name, job_func_t f, void* arg, wgroup_t* group, wgroup_t* after)
+{
+	job_t* j = CALLOC(job_t, 1);
+	*j = (job_t){name, f, arg, group, NULL};
+
+	if (group != NULL)
+	{
+		sfMutex_lock(group->mutex);
+		group->pending++;
+		sfMutex_unlock(group->mutex);
+	}
+
+	if (after != NULL)
+	{
+		sfMutex_lock(after->mutex);
+		char held = after->pending > 0;
+		if (held)
+		{
+			j->next = after->waiting;
+			after->waiting = j;
+		}
+		sfMutex_unlock(after->mutex);
+		if (held)
+			return;
+	}
+
+	schedule(j);
+}
+
+typedef struct
+{
+	jobs_range_t func;
+	void* arg;
+	size_t first;
+	size_t last;
+} range_t;
+
+static void range(void* arg)
+{
+	range_t* r = (range_t*) arg;
+	r->func(r->arg, r->first, r->last);
+}
+
+void jobs_for(const char* name, size_t n, size_t grain, jobs_range_t f, void* arg)
+{
+	if (n == 0)
+		return;
+	if (grain == 0)
+		grain = 1;
+	size_t n_ranges = (n + grain-1) / grain;
+	range_t* ranges = CALLOC(range_t, n_ranges);
+
+	wgroup_t g;
+	wgroup_init(&g);
+	for (size_t k = 0; k < n_ranges; k++)
+	{
+		size_t last = (k+1)*grain;
+		ranges[k] = (range_t){f, arg, k*grain, last < n ? last : n};
+		jobs_push(name, range, &ranges[k], &g, NULL);
+	}
+	wgroup_wait(&g);
+	wgroup_exit(&g);
+	free(ranges);
+}
+
+void jobs_report(FILE* f)
+{
+	sfMutex_lock(pool.mutex);
+	for (size_t k = 0; k < pool.n_stats; k++)
+	{
+		jobstat_t* s = &pool.stats[k];
+		fprintf(f, "%-16s %6u jobs %10.3fms total %8.3fms longest\n", s->name,
+			(unsigned) s->count, s->total / 1000., s->longest / 1000.);
+	}
+	sfMutex_unlock(pool.mutex);
+}
@@ -0,0 +1,66 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <SFML/System.h>
+
+// a pool of worker threads, each with a deque of jobs; a worker takes
+// the newest job of its own deque, or steals the oldest of another one
+
+typedef struct job job_t;
+
+// jobs that can be waited for
+typedef struct
+{
+	sfMutex* mutex;
+	size_t   pending; // jobs not finished yet
+	job_t*   waiting; // jobs started when none is pending
+} wgroup_t;
+
+typedef void (*job_func_t) (void* arg);
+typedef void (*jobs_range_t)(void* arg, size_t first, size_t last);
+
+// 0 threads for one per core
+void jobs_init(int n_threads);
+void jobs_exit(void);
+
+// the number of threads running jobs, the caller of wgroup_wait() included
+int jobs_threads(void);
+
+void wgroup_init(wgroup_t* g);
+void wgroup_exit(wgroup_t* g);
+
+// run jobs until every job of the group has finished
+void wgroup_wait(wgroup_t* g);
+
+// queue f(arg), counted in 'group'; it starts only once every job added
+// to 'after' so far has finished; both may be NULL; jobs of the same
+// name are timed together
+void jobs_push(const char* name, job_func_t f, void* arg, wgroup_t* group, wgroup_t* after);
+
+// f(arg, first, last) over [0,n) in ranges of 'grain', and wait for it
+void jobs_for(const char* name, size_t n, size_t grain, jobs_range_t f, void* arg);
+
+// time spent in jobs, by name
+void jobs_report(FILE* f);
+
+#endif
@@ -23,6 +23,7 @@
 #include <time.h>
 
 #include "version.h"
+#include "jobs.h"
 #include "menu.h"
 
 #define MAP_MIN_WIDTH  20
@@ -43,6 +44,16 @@ static void usage(const char* name)
 		"                    3 is debug\n"
 		"  -s, --size W H    set map's size to WxH tiles (>20)\n"
 		"  -b, --bots N      set the number of bots\n"
+		"  --ai-budget N     time given to bots each frame, in\n"
+		"                    microseconds (0 for no limit)\n"
+		"  --jumpflood       generate land on the tile grid directly\n"
+		"  --noise           generate land from noise, chunk by chunk\n"
+		"  --stream          generate chunks only when they are needed,\n"
+		"                    for very large maps\n"
+		"  --no-map-cache    always generate the map, without\n"
+		"                    reading or writing cache/map_*.cache\n"
+		"                    (only written for a given seed, and\n"
+		"                    the 16 most recent ones are kept)\n"
 		"  -r, --seed seed   set generation seed\n"
 		"                    if this parameter is omitted, the seed\n"
 		"                    is generated from the current time\n"
@@ -96,13 +107,17 @@ int main(int argc, char** argv)
 		.seed       = time(NULL),
 		.map_width  = 500,
 		.map_height = 500,
+		.generator  = WORLD_GEN_VORONOI,
+		.map_cache  = MAP_CACHE_READ,
 		.bots_count = 100,
+		.ai_budget  = 2000,
 		.verbosity  = 1,
 		.godmode    = 0,
 		.quickstart = 0,
 	};
 
 	// handling command line options; nothing fancy so no need for getopts()
+	char seeded = 0;
 	int curarg = 1;
 	while (curarg < argc)
 	{
@@ -174,6 +189,37 @@ int main(int argc, char** argv)
 			}
 			s.bots_count = n_bots;
 		}
+		else if (strcmp(option, "--ai-budget") == 0)
+		{
+			if (curarg == argc)
+			{
+				fprintf(stderr, "No budget was given\n");
+				usage(argv[0]);
+			}
+			int budget = strtol(argv[curarg++], NULL, 0);
+			if (budget < 0)
+			{
+				fprintf(stderr, "Must be a positive number (%i given)\n", budget);
+				usage(argv[0]);
+			}
+			s.ai_budget = budget;
+		}
+		else if (strcmp(option, "--jumpflood") == 0)
+		{
+			s.generator = WORLD_GEN_JUMPFLOOD;
+		}
+		else if (strcmp(option, "--noise") == 0)
+		{
+			s.generator = WORLD_GEN_NOISE;
+		}
+		else if (strcmp(option, "--stream") == 0)
+		{
+			s.stream = 1;
+		}
+		else if (strcmp(option, "--no-map-cache") == 0)
+		{
+			s.map_cache = MAP_CACHE_OFF;
+		}
 		else if (strcmp(option, "--seed") == 0 || strcmp(option, "-r") == 0)
 		{
 			if (curarg == argc)
@@ -182,6 +228,7 @@ int main(int argc, char** argv)
 				usage(argv[0]);
 			}
 			s.seed = strtol(argv[curarg++], NULL, 0);
+			seeded = 1;
 		}
 		else if (strcmp(option, "--quickstart") == 0 || strcmp(option, "-q") == 0)
 		{
@@ -198,6 +245,14 @@ int main(int argc, char** argv)
 		}
 	}
 
+	// maps of random seeds are not worth keeping
+	if (seeded && s.map_cache == MAP_CACHE_READ)
+		s.map_cache = MAP_CACHE_WRITE;
+
+	// only chunk-local generators can stream
+	if (s.stream && !WORLD_GEN_LOCAL(s.generator))
+		s.generator = WORLD_GEN_CELLS;
+
 // cleaning the potential tweaking from above
 #ifdef __WIN32__
 	for (int i = 0; i < argc; i++)
@@ -205,9 +260,14 @@ int main(int argc, char** argv)
 	free(argv);
 #endif
 
+	// one worker thread per core, for batch work
+	jobs_init(0);
+
 	// gives control to the menu, which in turns can start a game
 	menu(&s);
 
+	jobs_exit();
+
 	// hallelujah! it did not segfault yet!
 	return 0;
 }
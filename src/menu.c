@@ -19,11 +19,101 @@
 #include "menu.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <math.h>
 
+#include "mem.h"
 #include "widgets.h"
 #include "game.h"
+#include "progress.h"
+
+// a game whose world is generated on another thread, so that the window
+// stays responsive; it may start while the player is still configuring
+typedef struct
+{
+	game_t     game;
+	settings_t s; // settings the game was started with
+	char       load;
+	char       ok; // generation went to the end
+	progress_t progress;
+	sfThread*  thread;
+} pregen_t;
+
+// seconds the settings must stay the same before generating in the background
+#define PREGEN_DELAY 0.5
+
+// settings after which the world is the same
+static char pregen_matches(pregen_t* p, settings_t* s)
+{
+	return !p->load &&
+		p->s.seed       == strtoul(s->seed_txt, NULL, 0) &&
+		p->s.map_width  == s->map_width  &&
+		p->s.map_height == s->map_height &&
+		p->s.generator  == s->generator  &&
+		p->s.stream     == s->stream     &&
+		p->s.bots_count == s->bots_count;
+}
+
+static void pregen_run(void* arg)
+{
+	pregen_t* p = (pregen_t*) arg;
+	p->ok = game_generate(&p->game, p->load);
+	progress_set(&p->progress, PROGRESS_DONE, 1);
+}
+
+// a speculative world may never be played, so it does not add to the map cache
+static pregen_t* pregen_start(settings_t* s, graphics_t* gr, assets_t* a, char load, char speculative)
+{
+	pregen_t* p = CALLOC(pregen_t, 1);
+	p->s = *s;
+	p->s.seed = strtoul(s->seed_txt, NULL, 0);
+	if (speculative && p->s.map_cache == MAP_CACHE_WRITE)
+		p->s.map_cache = MAP_CACHE_READ;
+	p->load = load;
+	p->ok = 0;
+	progress_init(&p->progress);
+
+	// loading data uses the assets, which stay on this thread
+	game_prepare(&p->game, &p->s, gr, a);
+	p->game.w->progress = &p->progress;
+
+	p->thread = sfThread_create(pregen_run, p);
+	sfThread_launch(p->thread);
+	return p;
+}
+
+static char pregen_done(pregen_t* p)
+{
+	pstage_t stage;
+	float fraction;
+	progress_get(&p->progress, &stage, &fraction);
+	return stage == PROGRESS_DONE;
+}
+
+// waits for the thread, which cancellation makes short
+static void pregen_stop(pregen_t* p)
+{
+	if (p == NULL)
+		return;
+	sfThread_wait(p->thread);
+	sfThread_destroy(p->thread);
+	game_exit(&p->game);
+	progress_exit(&p->progress);
+	free(p);
+}
+
+// cancel the current generation without waiting for it, unless
+// another one is already being cancelled
+static void pregen_drop(pregen_t** cur, pregen_t** stale)
+{
+	if (*cur == NULL)
+		return;
+	progress_cancel(&(*cur)->progress);
+	pregen_stop(*stale);
+	*stale = *cur;
+	*cur = NULL;
+}
 
 static char mainmenu(settings_t* s, graphics_t* gr, assets_t* a, char do_draw)
 {
@@ -73,15 +163,162 @@ static char configmenu(settings_t* s, graphics_t* gr, assets_t* a, char do_draw)
 	return -1;
 }
 
-// create a new game with chosen settings or load a previous one and run it
-static void play(settings_t* s, graphics_t* gr, assets_t* a, char load)
+// show the progress of a generation until it is over; returns 0 if the
+// player cancelled it
+static char loading(pregen_t* p, graphics_t* gr, assets_t* a)
+{
+	static const char* labels[] =
+	{
+		"Préparation",
+		"Terrain",
+		"Bordures",
+		"Mines",
+		"Personnages",
+		"Terminé",
+	};
+
+	static sfText* text = NULL;
+	if (text == NULL)
+	{
+		text = sfText_create();
+		sfText_setFont(text, a->font);
+		sfText_setCharacterSize(text, 25);
+	}
+
+	sfRenderWindow* render = gr->render;
+	while (sfRenderWindow_isOpen(render) && !pregen_done(p))
+	{
+		sfVector2u size = sfRenderWindow_getSize(render);
+		float x = size.x / 2;
+		float y = size.y / 2;
+
+		sfEvent event;
+		while (sfRenderWindow_pollEvent(render, &event))
+		{
+			if (event.type == sfEvtClosed)
+			{
+				sfRenderWindow_close(render);
+				return 0;
+			}
+			else if (event.type == sfEvtKeyReleased && event.key.code == sfKeyEscape)
+				return 0;
+			else if (event.type == sfEvtMouseButtonReleased && draw_button(gr, a, x, y+50, "Annuler", 1, 0))
+				return 0;
+		}
+
+		pstage_t stage;
+		float fraction;
+		progress_get(&p->progress, &stage, &fraction);
+
+		sfRenderWindow_clear(render, sfBlack);
+
+		sfText_setUTF8(text, labels[stage]);
+		sfFloatRect rect = sfText_getLocalBounds(text);
+		sfVector2f pos = {floor(x-rect.width/2-rect.left), floor(y-50)};
+		sfText_setPosition(text, pos);
+		sfRenderWindow_drawText(render, text, NULL);
+
+		draw_progressbar(gr, x-150, y-10, 300, 20, (stage + fraction) / PROGRESS_DONE, -1);
+		draw_button(gr, a, x, y+50, "Annuler", 1, 1);
+
+		draw_cursor(gr, a, 0);
+		sfRenderWindow_display(render);
+
+		sfSleep(sfMilliseconds(15));
+	}
+	return sfRenderWindow_isOpen(render);
+}
+
+// tell why a generation failed, until the player goes back to the menu
+static void failure(graphics_t* gr, assets_t* a, const char* error)
+{
+	static sfText* title  = NULL;
+	static sfText* reason = NULL;
+	if (title == NULL)
+	{
+		title = sfText_create();
+		sfText_setFont(title, a->font);
+		sfText_setCharacterSize(title, 25);
+		sfText_setUTF8(title, "La génération a échoué");
+
+		reason = sfText_create();
+		sfText_setFont(reason, a->font);
+		sfText_setCharacterSize(reason, 15);
+	}
+	sfText_setUTF8(reason, error);
+
+	sfRenderWindow* render = gr->render;
+	while (sfRenderWindow_isOpen(render))
+	{
+		sfVector2u size = sfRenderWindow_getSize(render);
+		float x = size.x / 2;
+		float y = size.y / 2;
+
+		sfEvent event;
+		while (sfRenderWindow_pollEvent(render, &event))
+		{
+			if (event.type == sfEvtClosed)
+			{
+				sfRenderWindow_close(render);
+				return;
+			}
+			else if (event.type == sfEvtKeyReleased &&
+			         (event.key.code == sfKeyEscape || event.key.code == sfKeyReturn))
+				return;
+			else if (event.type == sfEvtMouseButtonReleased && draw_button(gr, a, x, y+50, "Retour", 1, 0))
+				return;
+		}
+
+		sfRenderWindow_clear(render, sfBlack);
+
+		sfFloatRect rect = sfText_getLocalBounds(title);
+		sfText_setPosition(title, (sfVector2f){floor(x-rect.width/2-rect.left), floor(y-50)});
+		sfRenderWindow_drawText(render, title, NULL);
+
+		rect = sfText_getLocalBounds(reason);
+		sfText_setPosition(reason, (sfVector2f){floor(x-rect.width/2-rect.left), floor(y)});
+		sfRenderWindow_drawText(render, reason, NULL);
+
+		draw_button(gr, a, x, y+50, "Retour", 1, 1);
+
+		draw_cursor(gr, a, 0);
+		sfRenderWindow_display(render);
+
+		sfSleep(sfMilliseconds(15));
+	}
+}
+
+// create a new game with chosen settings or load a previous one and run it;
+// the world may already be generating in the background
+static void play(settings_t* s, graphics_t* gr, assets_t* a, char load, pregen_t** cur, pregen_t** stale)
 {
 	s->seed = strtoul(s->seed_txt, NULL, 0);
 
-	game_t game;
-	game_init(&game, s, gr, a, load);
-	game_loop(&game);
-	game_exit(&game);
+	if (*cur == NULL || load || !pregen_matches(*cur, s))
+	{
+		pregen_drop(cur, stale);
+		*cur = pregen_start(s, gr, a, load, 0);
+	}
+	pregen_t* p = *cur;
+	*cur = NULL;
+
+	if (!loading(p, gr, a) || !p->ok)
+	{
+		progress_cancel(&p->progress);
+		const char* error = progress_error(&p->progress);
+		if (error != NULL)
+			failure(gr, a, error);
+		pregen_stop(p);
+		return;
+	}
+
+	// these do not change the world
+	p->s.godmode    = s->godmode;
+	p->s.quickstart = s->quickstart;
+
+	game_start(&p->game, load);
+	game_loop(&p->game);
+	pregen_stop(p);
 }
 
 void menu(settings_t* s)
@@ -98,11 +335,41 @@ void menu(settings_t* s)
 
 	sfSprite* illustration = assets_sprite(a, "data/menu.png");
 
+	// the world of the current settings is generated in the background
+	// while they are being configured, once they have not changed for a while
+	pregen_t* cur   = NULL;
+	pregen_t* stale = NULL;
+	settings_t last = *s;
+	sfClock* settled = sfClock_create();
+	char wanted = 0;
+
 	sfRenderWindow* render = gr->render;
 	char inconfig = 0;
 	char stayhere = 1;
 	while (stayhere && sfRenderWindow_isOpen(render))
 	{
+		if (stale != NULL && pregen_done(stale))
+		{
+			pregen_stop(stale);
+			stale = NULL;
+		}
+		if (strcmp(last.seed_txt, s->seed_txt) != 0 || last.map_width != s->map_width ||
+		    last.map_height != s->map_height || last.bots_count != s->bots_count)
+		{
+			last = *s;
+			sfClock_restart(settled);
+			wanted = 1;
+		}
+		if (cur != NULL && stale == NULL && !pregen_matches(cur, s))
+			pregen_drop(&cur, &stale);
+		if (cur != NULL && pregen_matches(cur, s))
+			wanted = 0;
+		if (wanted && cur == NULL && stale == NULL && sfTime_asSeconds(sfClock_getElapsedTime(settled)) > PREGEN_DELAY)
+		{
+			cur = pregen_start(s, gr, a, 0, 1);
+			wanted = 0;
+		}
+
 		// menu event loop
 		// thanks to polling (and no callbacks), a game can easily start its own event handling
 		sfEvent event;
@@ -134,9 +401,9 @@ void menu(settings_t* s)
 						stayhere = 0;
 				}
 				else if (event.key.code == sfKeyReturn)
-					play(s, gr, a, 0);
+					play(s, gr, a, 0, &cur, &stale);
 				else if (event.key.code == sfKeyC)
-					play(s, gr, a, 1);
+					play(s, gr, a, 1, &cur, &stale);
 			}
 			// handles clicking on a button
 			else if (event.type == sfEvtMouseButtonReleased)
@@ -150,11 +417,14 @@ void menu(settings_t* s)
 				{
 					int i = mainmenu(s, gr, a, 0);
 					if (i == 0)
-						play(s, gr, a, 0);
+						play(s, gr, a, 0, &cur, &stale);
 					else if (i == 1)
+					{
 						inconfig = 1;
+						wanted = 1;
+					}
 					else if (i == 2)
-						play(s, gr, a, 1);
+						play(s, gr, a, 1, &cur, &stale);
 					else if (i == 3)
 						stayhere = 0;
 				}
@@ -183,5 +453,9 @@ void menu(settings_t* s)
 		sfRenderWindow_display(render);
 	}
 
+	pregen_drop(&cur, &stale);
+	pregen_stop(stale);
+	sfClock_destroy(settled);
+
 	graphics_exit(gr);
 }
@@ -0,0 +1,101 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "progress.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+void progress_init(progress_t* p)
+{
+	p->mutex = sfMutex_create();
+	p->stage = PROGRESS_CHUNKS;
+	p->fraction = 0;
+	p->cancel = 0;
+	p->error = NULL;
+}
+
+void progress_exit(progress_t* p)
+{
+	sfMutex_destroy(p->mutex);
+}
+
+char progress_set(progress_t* p, pstage_t stage, float fraction)
+{
+	if (p == NULL)
+		return 1;
+	sfMutex_lock(p->mutex);
+	p->stage = stage;
+	p->fraction = fraction;
+	char ret = !p->cancel;
+	sfMutex_unlock(p->mutex);
+	return ret;
+}
+
+void progress_get(progress_t* p, pstage_t* stage, float* fraction)
+{
+	if (p == NULL)
+	{
+		*stage = PROGRESS_DONE;
+		*fraction = 1;
+		return;
+	}
+	sfMutex_lock(p->mutex);
+	*stage = p->stage;
+	*fraction = p->fraction;
+	sfMutex_unlock(p->mutex);
+}
+
+void progress_cancel(progress_t* p)
+{
+	if (p == NULL)
+		return;
+	sfMutex_lock(p->mutex);
+	p->cancel = 1;
+	sfMutex_unlock(p->mutex);
+}
+
+char progress_cancelled(progress_t* p)
+{
+	if (p == NULL)
+		return 0;
+	sfMutex_lock(p->mutex);
+	char ret = p->cancel;
+	sfMutex_unlock(p->mutex);
+	return ret;
+}
+
+void progress_fail(progress_t* p, const char* error)
+{
+	fprintf(stderr, "%s\n", error);
+	if (p == NULL)
+		exit(1);
+	sfMutex_lock(p->mutex);
+	p->error = error;
+	sfMutex_unlock(p->mutex);
+}
+
+const char* progress_error(progress_t* p)
+{
+	if (p == NULL)
+		return NULL;
+	sfMutex_lock(p->mutex);
+	const char* ret = p->error;
+	sfMutex_unlock(p->mutex);
+	return ret;
+}
@@ -0,0 +1,59 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <SFML/System.h>
+
+typedef enum
+{
+	PROGRESS_CHUNKS,
+	PROGRESS_LAND,
+	PROGRESS_BORDERS,
+	PROGRESS_MINES,
+	PROGRESS_CHARACTERS,
+	PROGRESS_DONE,
+} pstage_t;
+
+// progress of a generation running on another thread; it is reported by
+// the generator and read by the interface, which can cancel it
+typedef struct
+{
+	sfMutex* mutex;
+	pstage_t stage;
+	float    fraction; // of the current stage
+	char     cancel;
+	const char* error; // why the generation failed, or NULL
+} progress_t;
+
+void progress_init(progress_t* p);
+void progress_exit(progress_t* p);
+
+// these accept NULL, when there is nothing to report to;
+// progress_set() returns 0 if the generation was cancelled
+char progress_set      (progress_t* p, pstage_t stage, float fraction);
+void progress_get      (progress_t* p, pstage_t* stage, float* fraction);
+void progress_cancel   (progress_t* p);
+char progress_cancelled(progress_t* p);
+
+// a failure without anything to report to stops the program
+void        progress_fail (progress_t* p, const char* error);
+const char* progress_error(progress_t* p);
+
+#endif
@@ -0,0 +1,97 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "rand.h"
+
+#include <stdlib.h>
+
+#include "mem.h"
+
+static uint64_t splitmix64(uint64_t* x)
+{
+	uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+void rng_seed(rng_t* r, unsigned int seed, unsigned int stream)
+{
+	uint64_t x = (uint64_t) seed << 32 | stream;
+	uint64_t a = splitmix64(&x);
+	uint64_t b = splitmix64(&x);
+	r->s[0] = a;
+	r->s[1] = a >> 32;
+	r->s[2] = b;
+	r->s[3] = b >> 32;
+}
+
+void alias_init(alias_t* a, size_t n, const float* probas)
+{
+	a->n = n;
+	a->proba = CALLOC(float, n);
+	a->alias = CALLOC(int,   n);
+
+	float total = 0;
+	for (size_t i = 0; i < n; i++)
+		total += probas[i];
+
+	// split the entries below and above the average
+	int* small = CALLOC(int, n);
+	int* large = CALLOC(int, n);
+	size_t n_small = 0;
+	size_t n_large = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		a->proba[i] = probas[i] * n / total;
+		a->alias[i] = i;
+		if (a->proba[i] < 1)
+			small[n_small++] = i;
+		else
+			large[n_large++] = i;
+	}
+
+	// each small entry is topped up by a large one
+	while (n_small > 0 && n_large > 0)
+	{
+		int s = small[--n_small];
+		int l = large[n_large-1];
+		a->alias[s] = l;
+		a->proba[l] -= 1 - a->proba[s];
+		if (a->proba[l] < 1)
+		{
+			n_large--;
+			small[n_small++] = l;
+		}
+	}
+
+	// what remains is full, up to rounding errors
+	while (n_small > 0)
+		a->proba[small[--n_small]] = 1;
+	while (n_large > 0)
+		a->proba[large[--n_large]] = 1;
+
+	free(large);
+	free(small);
+}
+
+void alias_exit(alias_t* a)
+{
+	free(a->alias);
+	free(a->proba);
+}
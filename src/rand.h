@@ -19,27 +19,66 @@
 #ifndef RAND_H
 #define RAND_H
 
-#include <limits.h>
-#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 
-static inline float frnd(float min, float max)
+// xoshiro128** generator; each stream of a seed is independent
+typedef struct
 {
-	return min + ((float) rand() / RAND_MAX) * (max-min);
+	uint32_t s[4];
+} rng_t;
+
+void rng_seed(rng_t* r, unsigned int seed, unsigned int stream);
+
+static inline uint32_t rng_rotl(uint32_t x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+static inline uint32_t rng_next(rng_t* r)
+{
+	uint32_t* s = r->s;
+	uint32_t ret = rng_rotl(s[1] * 5, 7) * 9;
+	uint32_t t = s[1] << 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rng_rotl(s[3], 11);
+	return ret;
+}
+
+// uniform in [min, max)
+static inline float rng_float(rng_t* r, float min, float max)
+{
+	return min + (rng_next(r) >> 8) * (1.f / (1 << 24)) * (max-min);
 }
-static inline float cfrnd(float max)
+static inline float rng_cfloat(rng_t* r, float max)
 {
-	return frnd(-max/2, max/2);
+	return rng_float(r, -max/2, max/2);
 }
-static inline int rnd_pick(const float* probas)
-{
-	float selected = frnd(0, 1);
-	int i = 0;
-	while (selected > probas[i])
-	{
-		selected -= probas[i];
-		i++;
-	}
-	return i;
+
+// uniform in [0, n)
+static inline int rng_int(rng_t* r, int n)
+{
+	return ((uint64_t) rng_next(r) * n) >> 32;
+}
+
+// Walker's alias table, to pick i with probability probas[i] in O(1)
+typedef struct
+{
+	size_t n;
+	float* proba;
+	int*   alias;
+} alias_t;
+
+void alias_init(alias_t* a, size_t n, const float* probas);
+void alias_exit(alias_t* a);
+
+static inline int alias_pick(const alias_t* a, rng_t* r)
+{
+	int i = rng_int(r, a->n);
+	return rng_float(r, 0, 1) < a->proba[i] ? i : a->alias[i];
 }
 
 #endif
@@ -21,6 +21,21 @@
 
 typedef struct settings settings_t;
 
+// land generators
+#define WORLD_GEN_VORONOI   0 // rasterized Voronoi polygons
+#define WORLD_GEN_JUMPFLOOD 1 // Voronoi labelling of the tiles
+#define WORLD_GEN_CELLS     2 // chunk-local Voronoi cells
+#define WORLD_GEN_NOISE     3 // chunk-local warped value noise
+
+// generators whose chunks can be made independently
+#define WORLD_GEN_LOCAL(G) ((G) >= WORLD_GEN_CELLS)
+
+// uses of the map cache; files are only written for chosen seeds,
+// since a new one is made for every random seed otherwise
+#define MAP_CACHE_OFF   0
+#define MAP_CACHE_READ  1 // reuse generated maps from disk
+#define MAP_CACHE_WRITE 2 // and save new ones
+
 struct settings
 {
 	unsigned int seed;
@@ -28,8 +43,12 @@ struct settings
 
 	int map_width;
 	int map_height;
+	int generator;
+	char map_cache; // MAP_CACHE_*
+	char stream;    // generate chunks only when they are needed
 
 	int bots_count;
+	int ai_budget; // in microseconds per round
 
 	char verbosity;
 
@@ -1,5 +1,5 @@
 /*\
- *  Voronoi diagram by Fortune's algorithm
+ *  Role playing, management and strategy game
  *  Copyright (C) 2013-2014 Quentin SANTOS
  *
  *  This program is free software: you can redistribute it and/or modify
@@ -16,13 +16,31 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 \*/
 
-#ifndef QSORT_R_H
-#define QSORT_R_H
+#include "recipe.h"
 
-#include <sys/types.h>
+#include <stdlib.h>
 
-void qsort_r(void *base, size_t nmemb, size_t size,
-        int (*compar)(const void *, const void *, void *), 
-        void *arg);
+void recipe_init(recipe_t* r)
+{
+	r->mine = NULL;
+	r->building = NULL;
+	r->make = NULL;
 
-#endif
+	r->n_prep = 0;
+	r->prep = NULL;
+
+	r->n_raw = 0;
+	r->raw = NULL;
+
+	r->n_buildings = 0;
+	r->buildings = NULL;
+
+	r->state = 0;
+}
+
+void recipe_exit(recipe_t* r)
+{
+	free(r->buildings);
+	free(r->raw);
+	free(r->prep);
+}
@@ -0,0 +1,69 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef U_RECIPE_H
+#define U_RECIPE_H
+
+typedef struct requisite requisite_t;
+typedef struct recipe    recipe_t;
+
+#include <sys/types.h>
+
+#include "transform.h"
+#include "mine.h"
+#include "building.h"
+
+// component to gather before building a workshop; the amount
+// to get is 'amount' times the number of units wanted plus 'fixed'
+struct requisite
+{
+	char  is_item;
+	int   id;
+	float amount;
+	float fixed;
+};
+
+// how to obtain a material or an item
+struct recipe
+{
+	// where to gather it if it is a base material
+	kindOf_mine_t* mine;
+
+	// otherwise, where to make it and how
+	kindOf_building_t* building;
+	transform_t*       make;
+
+	// non-base components of 'make' merged with the cost of 'building'
+	size_t       n_prep;
+	requisite_t* prep;
+
+	// base materials needed for one unit (transitive closure)
+	size_t       n_raw;
+	component_t* raw;
+
+	// kinds of building needed along the production chain
+	size_t n_buildings;
+	int*   buildings;
+
+	char state; // 0: not computed, 1: computing, 2: done
+};
+
+void recipe_init(recipe_t* r);
+void recipe_exit(recipe_t* r);
+
+#endif
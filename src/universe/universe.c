@@ -108,6 +108,11 @@ void universe_init(universe_t* u, game_t* g)
 	universe_init_iskills    (u, g->a, cfg_ini_group(&ini, "CompetenceObjet"));
 	universe_init_items      (u, g->a, cfg_ini_group(&ini, "Objet"));
 	universe_init_buildings  (u, g->a, cfg_ini_group(&ini, "Batiment"));
+	universe_init_recipes    (u);
+
+	// compile bot plans against the production graph
+	for (size_t i = 0; i < u->n_bots; i++)
+		ai_compile(&u->bots[i], u);
 
 	if (g->s->verbosity >= 1)
 	{
@@ -187,6 +192,10 @@ void universe_exit(universe_t* u)
 		kindOf_status_exit(&u->statuses[i]);
 	*/
 
+	for (size_t i = 0; i < u->n_materials + u->n_items; i++)
+		recipe_exit(&u->recipes[i]);
+	free(u->recipes);
+
 	free(u->iskills);
 
 	for (size_t i = 0; i < u->n_skills; i++)
@@ -606,25 +615,165 @@ void universe_init_buildings(universe_t* u, assets_t* a, cfg_group_t* gr)
 	}
 }
 
-kindOf_mine_t* universe_mineFor(universe_t* u, char is_item, int id)
+static void recipe_prep(recipe_t* r, char is_item, int id, float amount, float fixed)
 {
-	for (size_t i = 0; i < u->n_mines; i++)
+	for (size_t i = 0; i < r->n_prep; i++)
 	{
-		kindOf_mine_t* t = &u->mines[i];
-		if (transform_is_res(&t->harvest, is_item, id) >= 0)
-			return t;
+		requisite_t* q = &r->prep[i];
+		if (q->is_item == is_item && q->id == id)
+		{
+			q->amount += amount;
+			q->fixed  += fixed;
+			return;
+		}
 	}
-	return NULL;
+	r->prep = CREALLOC(r->prep, requisite_t, r->n_prep+1);
+	r->prep[r->n_prep++] = (requisite_t){is_item, id, amount, fixed};
 }
 
-kindOf_building_t* universe_buildFor(universe_t* u, char is_item, int id)
+static void recipe_raw(recipe_t* r, char is_item, int id, float amount)
 {
-	for (size_t i = 0; i < u->n_buildings; i++)
+	for (size_t i = 0; i < r->n_raw; i++)
+	{
+		component_t* c = &r->raw[i];
+		if (c->is_item == is_item && c->id == id)
+		{
+			c->amount += amount;
+			return;
+		}
+	}
+	r->raw = CREALLOC(r->raw, component_t, r->n_raw+1);
+	r->raw[r->n_raw++] = (component_t){is_item, id, amount};
+}
+
+static void recipe_building(recipe_t* r, int id)
+{
+	for (size_t i = 0; i < r->n_buildings; i++)
+		if (r->buildings[i] == id)
+			return;
+	r->buildings = CREALLOC(r->buildings, int, r->n_buildings+1);
+	r->buildings[r->n_buildings++] = id;
+}
+
+// flatten the production chain of a component (memoized)
+static void recipe_close(universe_t* u, char is_item, int id)
+{
+	recipe_t* r = universe_recipe(u, is_item, id);
+	if (r->state != 0)
+		return;
+	r->state = 1;
+
+	if (r->mine != NULL || r->building == NULL)
+	{
+		recipe_raw(r, is_item, id, 1);
+		r->state = 2;
+		return;
+	}
+
+	recipe_building(r, r->building - u->buildings);
+
+	transform_t* tr = r->make;
+	float made = tr->res[transform_is_res(tr, is_item, id)].amount;
+	if (made <= 0)
+		made = 1;
+
+	for (int i = 0; i < tr->n_req; i++)
+	{
+		component_t* c = &tr->req[i];
+		float ratio = c->amount / made;
+
+		recipe_close(u, c->is_item, c->id);
+		recipe_t* s = universe_recipe(u, c->is_item, c->id);
+
+		// production cycle, stop there
+		if (s->state != 2)
+		{
+			recipe_raw(r, c->is_item, c->id, ratio);
+			continue;
+		}
+
+		for (size_t j = 0; j < s->n_raw; j++)
+		{
+			component_t* d = &s->raw[j];
+			recipe_raw(r, d->is_item, d->id, d->amount * ratio);
+		}
+		for (size_t j = 0; j < s->n_buildings; j++)
+			recipe_building(r, s->buildings[j]);
+	}
+
+	r->state = 2;
+}
+
+void universe_init_recipes(universe_t* u)
+{
+	size_t n = u->n_materials + u->n_items;
+	u->recipes = CALLOC(recipe_t, n);
+	for (size_t i = 0; i < n; i++)
+		recipe_init(&u->recipes[i]);
+
+	// producers (first ones found, as before)
+	for (ssize_t i = u->n_mines-1; i >= 0; i--)
+	{
+		kindOf_mine_t* m = &u->mines[i];
+		transform_t* tr = &m->harvest;
+		for (int j = 0; j < tr->n_res; j++)
+			universe_recipe(u, tr->res[j].is_item, tr->res[j].id)->mine = m;
+	}
+	for (ssize_t i = u->n_buildings-1; i >= 0; i--)
 	{
 		kindOf_building_t* b = &u->buildings[i];
-		transform_t* tr = kindOf_building_canMake(b, is_item, id);
-		if (tr != NULL)
-			return b;
+		for (ssize_t k = b->n_items-1; k >= -1; k--)
+		{
+			transform_t* tr = k < 0 ? &b->make : &b->items[k];
+			for (int j = 0; j < tr->n_res; j++)
+			{
+				recipe_t* r = universe_recipe(u, tr->res[j].is_item, tr->res[j].id);
+				r->building = b;
+				r->make = tr;
+			}
+		}
 	}
-	return NULL;
+
+	// what to gather before building the workshop
+	for (size_t i = 0; i < n; i++)
+	{
+		recipe_t* r = &u->recipes[i];
+		if (r->building == NULL)
+			continue;
+
+		transform_t* tr = r->make;
+		for (int j = 0; j < tr->n_req; j++)
+		{
+			component_t* c = &tr->req[j];
+			if (universe_mineFor(u, c->is_item, c->id) == NULL)
+				recipe_prep(r, c->is_item, c->id, c->amount, 0);
+		}
+
+		tr = &r->building->build;
+		for (int j = 0; j < tr->n_req; j++)
+		{
+			component_t* c = &tr->req[j];
+			recipe_prep(r, c->is_item, c->id, 0, c->amount);
+		}
+	}
+
+	for (size_t i = 0; i < u->n_materials; i++)
+		recipe_close(u, MATERIAL, i);
+	for (size_t i = 0; i < u->n_items; i++)
+		recipe_close(u, ITEM, i);
+}
+
+recipe_t* universe_recipe(universe_t* u, char is_item, int id)
+{
+	return &u->recipes[is_item ? u->n_materials + id : (size_t) id];
+}
+
+kindOf_mine_t* universe_mineFor(universe_t* u, char is_item, int id)
+{
+	return universe_recipe(u, is_item, id)->mine;
+}
+
+kindOf_building_t* universe_buildFor(universe_t* u, char is_item, int id)
+{
+	return universe_recipe(u, is_item, id)->building;
 }
@@ -33,6 +33,7 @@ typedef struct universe universe_t;
 #include "category.h"
 #include "equipment.h"
 #include "ini.h"
+#include "recipe.h"
 
 struct universe
 {
@@ -76,6 +77,9 @@ struct universe
 	size_t n_slots;
 	kindOf_slot_t* slots;
 
+	// production graph, materials then items
+	recipe_t* recipes;
+
 	// temporarily stores the harvest, transformation
 	// and fabrication information
 	transform_t* tmp_materials;
@@ -94,6 +98,9 @@ void universe_init_mines      (universe_t* u, assets_t* a, cfg_group_t* gr);
 void universe_init_iskills    (universe_t* u, assets_t* a, cfg_group_t* gr);
 void universe_init_items      (universe_t* u, assets_t* a, cfg_group_t* gr);
 void universe_init_buildings  (universe_t* u, assets_t* a, cfg_group_t* gr);
+void universe_init_recipes    (universe_t* u);
+
+recipe_t*          universe_recipe  (universe_t* u, char is_item, int id);
 
 kindOf_mine_t*     universe_mineFor (universe_t* u, char is_item, int id);
 kindOf_building_t* universe_buildFor(universe_t* u, char is_item, int id);
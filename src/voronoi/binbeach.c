@@ -24,28 +24,103 @@
 void vr_binbeach_init(vr_binbeach_t* b)
 {
 	b->root = NULL;
+	b->seed = 2463534242u;
+	b->spare = NULL;
 }
 
-static void exit_aux(vr_bnode_t* n)
+static void release(vr_binbeach_t* b, vr_bnode_t* n)
+{
+	n->parent = b->spare;
+	b->spare = n;
+}
+
+static void clear_aux(vr_binbeach_t* b, vr_bnode_t* n)
 {
 	if (n == NULL)
 		return;
 
-	exit_aux(n->left);
-	exit_aux(n->right);
-	free(n);
+	clear_aux(b, n->left);
+	clear_aux(b, n->right);
+	release(b, n);
+}
+void vr_binbeach_clear(vr_binbeach_t* b)
+{
+	clear_aux(b, b->root);
+	b->root = NULL;
 }
+
 void vr_binbeach_exit(vr_binbeach_t* b)
 {
-	exit_aux(b->root);
+	vr_binbeach_clear(b);
+	while (b->spare != NULL)
+	{
+		vr_bnode_t* n = b->spare;
+		b->spare = n->parent;
+		free(n);
+	}
+}
+
+static vr_bnode_t* new_node(vr_binbeach_t* b)
+{
+	vr_bnode_t* n = b->spare;
+	if (n == NULL)
+		return CALLOC(vr_bnode_t, 1);
+	b->spare = n->parent;
+	return n;
+}
+
+// xorshift; does not touch rand() so that maps stay the same
+static unsigned int prio(vr_binbeach_t* b)
+{
+	unsigned int x = b->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	b->seed = x;
+	return x;
+}
+
+// put n in place of its parent
+static void rotate(vr_binbeach_t* b, vr_bnode_t* n)
+{
+	vr_bnode_t* p  = n->parent;
+	vr_bnode_t* pp = p->parent;
+
+	if (n == p->left)
+	{
+		p->left = n->right;
+		p->left->parent = p;
+		n->right = p;
+	}
+	else
+	{
+		p->right = n->left;
+		p->right->parent = p;
+		n->left = p;
+	}
+	p->parent = n;
+
+	n->parent = pp;
+	if (pp == NULL)
+		b->root = n;
+	else if (p == pp->left)
+		pp->left = n;
+	else
+		pp->right = n;
+}
+
+static void bubbleUp(vr_binbeach_t* b, vr_bnode_t* n)
+{
+	while (n->parent != NULL && n->prio > n->parent->prio)
+		rotate(b, n);
 }
 
 vr_bnode_t* vr_binbeach_breakAt(vr_binbeach_t* b, double sweep, struct vr_region* r)
 {
 	if (b->root == NULL)
 	{
-		vr_bnode_t* n = CALLOC(vr_bnode_t, 1);
-		*n = (vr_bnode_t){r, NULL, NULL, NULL, NULL, NULL, NULL};
+		vr_bnode_t* n = new_node(b);
+		*n = (vr_bnode_t){r, NULL, NULL, NULL, NULL, NULL, NULL, 0};
 		b->root = n;
 		return n;
 	}
@@ -63,31 +138,42 @@ vr_bnode_t* vr_binbeach_breakAt(vr_binbeach_t* b, double sweep, struct vr_region
 			n = n->right;
 	}
 
-	// left leaf (original region)
-	vr_bnode_t* ll = CALLOC(vr_bnode_t, 1);
-	*ll = (vr_bnode_t){n->r1, NULL, NULL, NULL, n, NULL, n->event};
+	// left leaf (original region); the circle event of the split
+	// arc is left to the caller, which recomputes both sides
+	vr_bnode_t* ll = new_node(b);
+	*ll = (vr_bnode_t){n->r1, NULL, NULL, NULL, n, NULL, n->event, 0};
 	n->left = ll;
 
 	// new internal node
-	vr_bnode_t* ni = CALLOC(vr_bnode_t, 1);
+	vr_bnode_t* ni = new_node(b);
 
 	// middle leaf (new region)
-	vr_bnode_t* ml = CALLOC(vr_bnode_t, 1);
-	*ml = (vr_bnode_t){r, NULL, NULL, NULL, ni, NULL, NULL};
+	vr_bnode_t* ml = new_node(b);
+	*ml = (vr_bnode_t){r, NULL, NULL, NULL, ni, NULL, NULL, 0};
 
 	// right leaf (original region)
-	vr_bnode_t* rl = CALLOC(vr_bnode_t, 1);
-	*rl = (vr_bnode_t){n->r1, NULL, NULL, NULL, ni, NULL, n->event};
+	vr_bnode_t* rl = new_node(b);
+	*rl = (vr_bnode_t){n->r1, NULL, NULL, NULL, ni, NULL, NULL, 0};
+
+	// n stays above ni, so it takes the higher priority
+	unsigned int p1 = prio(b);
+	unsigned int p2 = prio(b);
 
 	// filling new internal node
-	*ni = (vr_bnode_t){r, n->r1, ml, rl, n, NULL, NULL};
+	*ni = (vr_bnode_t){r, n->r1, ml, rl, n, NULL, NULL, p1 < p2 ? p1 : p2};
 
 	// filling old leaf node (now internal)
 	n->r2    = r;
 	n->left  = ll;
 	n->right = ni;
+	n->event = NULL;
+	n->prio  = p1 < p2 ? p2 : p1;
 
-	return n;
+	// restore heap order on priorities
+	bubbleUp(b, n);
+	bubbleUp(b, ni);
+
+	return ml;
 }
 
 vr_bnode_t* vr_bnode_left(vr_bnode_t* n)
@@ -126,7 +212,7 @@ vr_bnode_t* vr_bnode_next(vr_bnode_t* n)
 	return n;
 }
 
-vr_bnode_t* vr_bnode_remove(vr_bnode_t* n)
+vr_bnode_t* vr_bnode_remove(vr_binbeach_t* b, vr_bnode_t* n)
 {
 	vr_bnode_t* p = n->parent;
 
@@ -147,15 +233,16 @@ vr_bnode_t* vr_bnode_remove(vr_bnode_t* n)
 		a->r1 = p->r1;
 	}
 
-	// find where to put sibling
+	// find where to put sibling; p had the highest priority
+	// of the subtree, so this keeps the heap order
 	vr_bnode_t* pp = p->parent;
-	vr_bnode_t** x = p == pp->left ? &pp->left  : &pp->right;
+	vr_bnode_t** x = pp == NULL ? &b->root : p == pp->left ? &pp->left : &pp->right;
 
 	*x = s;
 	s->parent = pp;
 
-	free(n);
-	free(p);
+	release(b, n);
+	release(b, p);
 
 	return a;
 }
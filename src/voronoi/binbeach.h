@@ -32,6 +32,7 @@ struct vr_event;
 // internal nodes are breakpoints
 // (two regions, two children, 'end' set)
 // leaves are arcs (one region, no child, 'event' set)
+// breakpoints are kept balanced as a treap on 'prio'
 struct vr_bnode
 {
 	struct vr_region* r1;
@@ -45,16 +46,24 @@ struct vr_bnode
 	point_t** end;
 
 	struct vr_event* event;
+
+	unsigned int prio;
 };
 
 struct vr_binbeach
 {
 	vr_bnode_t* root;
+	unsigned int seed;
+
+	// nodes to reuse, chained by 'parent'
+	vr_bnode_t* spare;
 };
 
-void vr_binbeach_init(vr_binbeach_t* b);
-void vr_binbeach_exit(vr_binbeach_t* b);
+void vr_binbeach_init (vr_binbeach_t* b);
+void vr_binbeach_exit (vr_binbeach_t* b);
+void vr_binbeach_clear(vr_binbeach_t* b);
 
+// insert the arc of a new region, return its leaf
 vr_bnode_t* vr_binbeach_breakAt(vr_binbeach_t* b, double sweep, struct vr_region* r);
 
 // vr_bnode_X finds closest ancestor of n for which n is X to
@@ -65,6 +74,6 @@ vr_bnode_t* vr_bnode_prev(vr_bnode_t* n);
 vr_bnode_t* vr_bnode_next(vr_bnode_t* n);
 
 // remove an arc, return the new breakpoint
-vr_bnode_t* vr_bnode_remove(vr_bnode_t* n);
+vr_bnode_t* vr_bnode_remove(vr_binbeach_t* b, vr_bnode_t* n);
 
 #endif
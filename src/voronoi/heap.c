@@ -34,62 +34,60 @@ void heap_exit(heap_t* h)
 	free(h->tree);
 }
 
-static inline int max(int a, int b)
-{
-	return a > b ? a : b;
-}
 static inline size_t parent(size_t i)
 {
-	return max(0, ((ssize_t)i+1)/2-1);
-}
-static inline size_t left(size_t i)
-{
-	return 2*i+1;
+	return (i-1) / HEAP_D;
 }
-static inline size_t right(size_t i)
+static inline size_t child(size_t i)
 {
-	return 2*i+2;
+	return HEAP_D*i + 1;
 }
-static inline void xchg(heap_t* h, size_t i, size_t j)
+static inline void set(heap_t* h, size_t i, hnode_t n)
 {
-	hnode_t tmp = h->tree[i];
-	h->tree[i] = h->tree[j];
-	h->tree[j] = tmp;
+	h->tree[i] = n;
+	if (n.pos != NULL)
+		*n.pos = i;
 }
 static void bubbleUp(heap_t* h, size_t i)
 {
-	size_t p = parent(i);
-	while (h->tree[i].idx < h->tree[p].idx)
+	hnode_t n = h->tree[i];
+	while (i > 0)
 	{
-		xchg(h, i, p);
+		size_t p = parent(i);
+		if (!(n.idx < h->tree[p].idx))
+			break;
+		set(h, i, h->tree[p]);
 		i = p;
-		p = parent(i);
 	}
+	set(h, i, n);
 }
 static void sinkDown(heap_t* h, size_t i)
 {
+	hnode_t n = h->tree[i];
 	while (1)
 	{
-		size_t l = left(i);
-		size_t r = right(i);
+		size_t c = child(i);
+		if (c >= h->size)
+			break;
 
-		size_t next = i;
-		if (l < h->size && h->tree[l].idx < h->tree[next].idx)
-			next = l;
-		if (r < h->size && h->tree[r].idx < h->tree[next].idx)
-			next = r;
+		size_t end = c + HEAP_D;
+		if (end > h->size)
+			end = h->size;
 
-		if (next != i)
-		{
-			xchg(h, i, next);
-			i = next;
-		}
-		else
+		size_t next = c;
+		for (c++; c < end; c++)
+			if (h->tree[c].idx < h->tree[next].idx)
+				next = c;
+
+		if (!(h->tree[next].idx < n.idx))
 			break;
+		set(h, i, h->tree[next]);
+		i = next;
 	}
+	set(h, i, n);
 }
 
-void heap_insert(heap_t* h, double idx, void* data)
+void heap_insert(heap_t* h, double idx, void* data, size_t* pos)
 {
 	if (h->size == h->avail)
 	{
@@ -99,7 +97,7 @@ void heap_insert(heap_t* h, double idx, void* data)
 	}
 
 	size_t i = h->size++;
-	h->tree[i] = (hnode_t){idx,data};
+	set(h, i, (hnode_t){idx,data,pos});
 	bubbleUp(h, i);
 }
 
@@ -107,19 +105,25 @@ void* heap_remove(heap_t* h)
 {
 	if (h->size == 0)
 		return NULL;
+	return heap_delete(h, 0);
+}
 
-	void* ret = h->tree[0].data;
-	if (--h->size != 0)
-	{
-		xchg(h, 0, h->size);
-		sinkDown(h, 0);
-	}
+void* heap_delete(heap_t* h, size_t i)
+{
+	assert(i < h->size);
 
-	if (h->size < h->avail/4)
+	void* ret = h->tree[i].data;
+	if (--h->size != i)
 	{
-		h->avail /= 2;
-		h->tree = (hnode_t*) realloc(h->tree, sizeof(hnode_t)*h->avail);
-		assert(h->tree != NULL);
+		// move the last node in the hole
+		double idx = h->tree[i].idx;
+		set(h, i, h->tree[h->size]);
+		if (h->tree[i].idx < idx)
+			bubbleUp(h, i);
+		else
+			sinkDown(h, i);
 	}
+
+	// the tree keeps its capacity for reuse
 	return ret;
 }
@@ -24,10 +24,16 @@ typedef struct heap  heap_t;
 
 #include <sys/types.h>
 
+// arity of the heap
+#define HEAP_D 4
+
 struct hnode
 {
 	double idx;
 	void* data;
+
+	// updated with the position of the node, when set
+	size_t* pos;
 };
 
 struct heap
@@ -40,7 +46,8 @@ struct heap
 void heap_init(heap_t* h);
 void heap_exit(heap_t* h);
 
-void  heap_insert(heap_t* h, double idx, void* data);
+void  heap_insert(heap_t* h, double idx, void* data, size_t* pos);
 void* heap_remove(heap_t* h);
+void* heap_delete(heap_t* h, size_t i);
 
 #endif
@@ -21,44 +21,27 @@
 #include <stdlib.h>
 #include <math.h>
 
-#include "qsort_r.h"
+#include "../jobs.h"
 
-# define M_PI		3.14159265358979323846	/* pi */
-
-static double heading(point_t p)
+// monotonic with the heading of p, in [0,4); cheaper than atan()
+static double pseudo_angle(point_t p)
 {
-	double dir;
-	if (p.x > 0)
-	{
-		dir = atan(p.y / p.x);
-		if (p.y < 0)
-			dir += 2 * M_PI;
-	}
-	else if (p.x < 0)
-	{
-		dir = atan(p.y / p.x) + M_PI;
-	}
-	else // p.x == 0
-	{
-		dir = M_PI / 2;
-		if (p.y < 0)
-			dir += M_PI;
-	}
-	return dir;
-}
-static int poly_vert(const void* a, const void* b, void* arg)
-{
-	const point_t* pa = (const point_t*) a;
-	const point_t* pb = (const point_t*) b;
-	point_t* c = (point_t*) arg;
-	double da = heading((point_t){pa->x-c->x, pa->y-c->y});
-	double db = heading((point_t){pb->x-c->x, pb->y-c->y});
-	return da < db ? -1 : da > db ? +1 : 0;
+	double d = fabs(p.x) + fabs(p.y);
+	if (d == 0)
+		return 1;
+
+	double a = p.y / d;
+	if (p.x < 0)
+		return 2 - a;
+	if (p.y < 0)
+		return 4 + a;
+	return a;
 }
 void vr_region_points(point_t* dst, vr_region_t* r)
 {
 	// gather vertices (twice)
-	point_t tmp[2*r->n_edges];
+	size_t n = 2*r->n_edges;
+	point_t tmp[n];
 	for (size_t j = 0; j < r->n_edges; j++)
 	{
 		segment_t* s = &r->edges[j]->s;
@@ -68,31 +51,51 @@ void vr_region_points(point_t* dst, vr_region_t* r)
 
 	// compute mean point (inside polygon)
 	point_t mean = {0,0};
-	for (size_t j = 0; j < 2*r->n_edges; j++)
+	for (size_t j = 0; j < n; j++)
 	{
 		mean.x += tmp[j].x;
 		mean.y += tmp[j].y;
 	}
-	mean.x /= 2*r->n_edges;
-	mean.y /= 2*r->n_edges;
+	mean.x /= n;
+	mean.y /= n;
 
-	// order vertices
-	qsort_r(tmp, 2*r->n_edges, sizeof(point_t), poly_vert, &mean);
+	// order vertices; there are only a few of them
+	double key[n];
+	for (size_t j = 0; j < n; j++)
+		key[j] = pseudo_angle(point_minus(tmp[j], mean));
+	for (size_t j = 1; j < n; j++)
+	{
+		point_t p = tmp[j];
+		double  k = key[j];
+		size_t  l = j;
+		for (; l > 0 && key[l-1] > k; l--)
+		{
+			tmp[l] = tmp[l-1];
+			key[l] = key[l-1];
+		}
+		tmp[l] = p;
+		key[l] = k;
+	}
 
 	// filter out multiple points
 	for (size_t j = 0; j < r->n_edges; j++)
 		dst[j] = tmp[2*j];
 }
 
-void vr_lloyd_relaxation(vr_diagram_t* v)
+typedef struct
 {
-	vr_diagram_end(v);
+	vr_diagram_t* v;
+	point_t* centroids;
+	char* inside;
+} lloyd_job_t;
 
-	point_t npoints[v->n_regions];
-	size_t k = 0;
-	for (size_t i = 0; i < v->n_regions; i++)
+static void centroids(void* arg, size_t first, size_t last)
+{
+	lloyd_job_t* job = (lloyd_job_t*) arg;
+	vr_diagram_t* v = job->v;
+	for (size_t i = first; i < last; i++)
 	{
-		vr_region_t* r = v->regions[i];
+		vr_region_t* r = &v->regions[i];
 
 		// gather vertices
 		point_t vertices[r->n_edges];
@@ -101,16 +104,29 @@ void vr_lloyd_relaxation(vr_diagram_t* v)
 		// compute centroid
 		point_t c = point_centroid(r->n_edges, vertices);
 
-		if (0 <= c.x && c.x <= v->width && 0 <= c.y && c.y <= v->height)
-		{
-			npoints[k].x = c.x;
-			npoints[k].y = c.y;
-			k++;
-		}
+		job->centroids[i] = c;
+		job->inside[i] = 0 <= c.x && c.x <= v->width && 0 <= c.y && c.y <= v->height;
 	}
-	double w = v->width;
-	double h = v->height;
-	vr_diagram_exit(v);
-	vr_diagram_init(v, w, h);
+}
+
+void vr_lloyd_relaxation(vr_diagram_t* v)
+{
+	vr_diagram_end(v);
+
+	// regions are shared among jobs by contiguous ranges
+	size_t n = v->n_regions;
+	point_t npoints[n];
+	char inside[n];
+
+	lloyd_job_t job = {v, npoints, inside};
+	jobs_for("lloyd", n, LLOYD_GRAIN, centroids, &job);
+
+	// keep the order of the regions
+	size_t k = 0;
+	for (size_t i = 0; i < n; i++)
+		if (inside[i])
+			npoints[k++] = npoints[i];
+
+	vr_diagram_reset(v);
 	vr_diagram_points(v, k, npoints);
 }
@@ -21,6 +21,9 @@
 
 #include "voronoi.h"
 
+// regions per centroid job
+#define LLOYD_GRAIN 1024
+
 // returns the ordered points around a region
 void vr_region_points(point_t* dst, vr_region_t* r);
 
@@ -39,55 +39,71 @@ void vr_diagram_init(vr_diagram_t* v, double w, double h)
 	v->a_regions = 0;
 	v->regions   = NULL;
 
+	v->a_links = 0;
+	v->links   = NULL;
+	v->vlinks  = NULL;
+
+	v->a_sites  = 0;
+	v->sites    = NULL;
+	v->cur_site = 0;
+
 	heap_init(&v->events);
+	v->spare_events = NULL;
 	vr_binbeach_init(&v->front);
 	v->sweepline  = 0;
 }
 
-void vr_diagram_exit(vr_diagram_t* v)
+static void free_events(vr_diagram_t* v)
 {
-	vr_binbeach_exit(&v->front);
-
 	vr_event_t* e;
 	while ((e = heap_remove(&v->events)) != NULL)
-		free(e);
-	heap_exit(&v->events);
-
-	for (size_t i = 0; i < v->n_regions; i++)
 	{
-		vr_region_t* r = v->regions[i];
-		free(r->edges);
-		free(r);
+		e->next = v->spare_events;
+		v->spare_events = e;
 	}
-	free(v->regions);
+}
 
-	for (size_t i = 0; i < v->n_edges; i++)
-		free(v->edges[i]);
-	free(v->edges);
+void vr_diagram_exit(vr_diagram_t* v)
+{
+	vr_binbeach_exit(&v->front);
 
-	for (size_t i = 0; i < v->n_vertices; i++)
+	free_events(v);
+	while (v->spare_events != NULL)
 	{
-		vr_vertex_t* p = v->vertices[i];
-		free(p->edges);
-		free(p);
+		vr_event_t* e = v->spare_events;
+		v->spare_events = e->next;
+		free(e);
 	}
+	heap_exit(&v->events);
+
+	free(v->sites);
+	free(v->vlinks);
+	free(v->links);
+	free(v->regions);
+	free(v->edges);
 	free(v->vertices);
 }
 
+void vr_diagram_reset(vr_diagram_t* v)
+{
+	vr_binbeach_clear(&v->front);
+	free_events(v);
+
+	v->n_vertices = 0;
+	v->n_edges    = 0;
+	v->n_regions  = 0;
+	v->cur_site   = 0;
+	v->sweepline  = 0;
+}
+
 void vr_diagram_point(vr_diagram_t* v, point_t p)
 {
 	if (v->n_regions == v->a_regions)
 	{
 		v->a_regions = v->a_regions == 0 ? 1 : 2*v->a_regions;
-		v->regions = CREALLOC(v->regions, vr_region_t*, v->a_regions);
+		v->regions = CREALLOC(v->regions, vr_region_t, v->a_regions);
 	}
-	vr_region_t* r = CALLOC(vr_region_t, 1);
-	*r = (vr_region_t){p, 0, NULL};
-	v->regions[v->n_regions++] = r;
-
-	vr_event_t* e = CALLOC(vr_event_t, 1);
-	*e = (vr_event_t){0, 1, r, NULL, NULL};
-	heap_insert(&v->events, p.x, e);
+	v->regions[v->n_regions++] = (vr_region_t){p, 0, NULL};
 }
 
 void vr_diagram_points(vr_diagram_t* v, size_t n, point_t* p)
@@ -100,19 +116,25 @@ static vr_vertex_t* new_vertex(vr_diagram_t* v)
 {
 	if (v->n_vertices == v->a_vertices)
 	{
-		v->a_vertices = v->a_vertices == 0 ? 1 : 2*v->a_vertices;
-		v->vertices = CREALLOC(v->vertices, vr_vertex_t*, v->a_vertices);
+		fprintf(stderr, "Too many Voronoi vertices\n");
+		exit(1);
 	}
-	vr_vertex_t* np = CALLOC(vr_vertex_t, 1);
+	vr_vertex_t* np = &v->vertices[v->n_vertices++];
 	*np = (vr_vertex_t) {{0,0}, 0, NULL};
-	v->vertices[v->n_vertices++] = np;
 	return np;
 }
-static void push_circle(vr_diagram_t* v, vr_bnode_t* n)
+static void drop_circle(vr_diagram_t* v, vr_bnode_t* n)
 {
-	if (n->event != NULL)
-		n->event->active = 0;
+	if (n->event == NULL)
+		return;
+	vr_event_t* e = heap_delete(&v->events, n->event->pos);
+	e->next = v->spare_events;
+	v->spare_events = e;
 	n->event = NULL;
+}
+static void push_circle(vr_diagram_t* v, vr_bnode_t* n)
+{
+	drop_circle(v, n);
 
 	// find previous and next arcs
 	vr_bnode_t* pa = vr_bnode_prev(n);
@@ -126,75 +148,124 @@ static void push_circle(vr_diagram_t* v, vr_bnode_t* n)
 	if (!circle_from3(&p, &r, &pa->r1->p, &n->r1->p, &na->r1->p))
 		return;
 
-	vr_event_t* e = CALLOC(vr_event_t, 1);
-	e->active = 1;
-	e->r = n->r1;
-
-	e->p = new_vertex(v);
-	e->p->p = p;
-
-	e->is_circle = 1;
+	vr_event_t* e = v->spare_events;
+	if (e != NULL)
+		v->spare_events = e->next;
+	else
+		e = CALLOC(vr_event_t, 1);
+	e->c = p;
 	e->n = n;
-	heap_insert(&v->events, e->p->p.x + r, e);
+	heap_insert(&v->events, p.x + r, e, &e->pos);
 	n->event = e;
 }
 
-static void region_addEdge(vr_region_t* a, vr_edge_t* e)
-{
-	a->edges = CREALLOC(a->edges, vr_edge_t*, a->n_edges+1);
-	a->edges[a->n_edges++] = e;
-}
 static vr_edge_t* new_edge(vr_diagram_t* v, vr_region_t* a, vr_region_t* b)
 {
 	if (v->n_edges == v->a_edges)
 	{
-		v->a_edges = v->a_edges == 0 ? 1 : 2*v->a_edges;
-		v->edges = CREALLOC(v->edges, vr_edge_t*, v->a_edges);
+		fprintf(stderr, "Too many Voronoi edges\n");
+		exit(1);
 	}
 
-	vr_edge_t* e = CALLOC(vr_edge_t, 1);
+	vr_edge_t* e = &v->edges[v->n_edges++];
 	*e = (vr_edge_t){{NULL, NULL}, a, b};
-	if (a != NULL) region_addEdge(a, e);
-	if (b != NULL) region_addEdge(b, e);
-
-	v->edges[v->n_edges++] = e;
 	return e;
 }
-char vr_diagram_step(vr_diagram_t* v)
+// a region only gets its own edges after vr_diagram_end()
+static void region_addEdge(vr_region_t* a, vr_edge_t* e)
+{
+	a->edges[a->n_edges++] = e;
+}
+static int site_cmp(const void* a, const void* b)
+{
+	const point_t* pa = &(*(vr_region_t* const*) a)->p;
+	const point_t* pb = &(*(vr_region_t* const*) b)->p;
+	if (pa->x != pb->x)
+		return pa->x < pb->x ? -1 : 1;
+	return pa->y < pb->y ? -1 : pa->y > pb->y ? 1 : 0;
+}
+// regions cannot be added anymore, reserve everything else
+static void reserve(vr_diagram_t* v)
 {
-	double idx = 0;
-	if (v->events.size != 0)
-		idx = v->events.tree[0].idx;
+	size_t n = v->n_regions;
 
-	vr_event_t* e = heap_remove(&v->events);
-	if (e == NULL)
-		return 0;
+	// at most 2n vertices from circle events, 2n when closing
+	// remaining breakpoints and 2n when cropping regions
+	size_t a_vertices = 6*n + 8;
+	if (v->a_vertices < a_vertices)
+	{
+		v->a_vertices = a_vertices;
+		v->vertices = CREALLOC(v->vertices, vr_vertex_t, a_vertices);
+	}
 
-	if (!e->active)
+	// at most 3n from the sweep and 2n when cropping regions
+	size_t a_edges = 5*n + 8;
+	if (v->a_edges < a_edges)
 	{
-		free(e);
-		return 1;
+		v->a_edges = a_edges;
+		v->edges = CREALLOC(v->edges, vr_edge_t, a_edges);
+	}
+
+	// each edge has two sides; two spare slots per region for cropping
+	size_t a_links = 2*a_edges + 2*n;
+	if (v->a_links < a_links)
+	{
+		v->a_links = a_links;
+		v->links  = CREALLOC(v->links,  vr_edge_t*, a_links);
+		v->vlinks = CREALLOC(v->vlinks, vr_edge_t*, a_links);
+	}
+
+	if (v->a_sites < n)
+	{
+		v->a_sites = n;
+		v->sites = CREALLOC(v->sites, vr_region_t*, n);
 	}
+}
+static void sort_sites(vr_diagram_t* v)
+{
+	reserve(v);
+	for (size_t i = 0; i < v->n_regions; i++)
+		v->sites[i] = &v->regions[i];
+	qsort(v->sites, v->n_regions, sizeof(vr_region_t*), site_cmp);
+	v->cur_site = 0;
+}
+char vr_diagram_step(vr_diagram_t* v)
+{
+	if (v->cur_site == 0 && v->front.root == NULL)
+		sort_sites(v);
 
-	v->sweepline = idx;
+	// merge site events with circle events
+	vr_region_t* r = v->cur_site < v->n_regions ? v->sites[v->cur_site] : NULL;
+	char is_circle = v->events.size != 0 && (r == NULL || v->events.tree[0].idx < r->p.x);
+	if (!is_circle && r == NULL)
+		return 0;
 
-	if (e->is_circle)
+	if (is_circle)
 	{
+		v->sweepline = v->events.tree[0].idx;
+		vr_event_t* e = heap_remove(&v->events);
+
 		// current arc
 		vr_bnode_t* n = e->n;
+		n->event = NULL;
+
+		vr_vertex_t* p = new_vertex(v);
+		p->p = e->c;
+		e->next = v->spare_events;
+		v->spare_events = e;
 
 		// finish edges at breakpoints
 		vr_bnode_t* lb = vr_bnode_right(n);
 		vr_bnode_t* rb = vr_bnode_left (n);
-		*lb->end = &e->p->p;
-		*rb->end = &e->p->p;
+		*lb->end = &p->p;
+		*rb->end = &p->p;
 
 		// save previous and next arcs
 		vr_bnode_t* pa = vr_bnode_prev(n);
 		vr_bnode_t* na = vr_bnode_next(n);
 
 		// remove arc
-		n = vr_bnode_remove(n);
+		n = vr_bnode_remove(&v->front, n);
 
 		// refresh circle events
 		push_circle(v, pa);
@@ -202,30 +273,30 @@ char vr_diagram_step(vr_diagram_t* v)
 
 		// start new edge
 		vr_edge_t* f = new_edge(v, pa->r1, na->r1);
-		f->s.a = &e->p->p;
+		f->s.a = &p->p;
 		n->end = &f->s.b;
 	}
 	else
 	{
-		vr_bnode_t* n = vr_binbeach_breakAt(&v->front, v->sweepline, e->r);
+		v->sweepline = r->p.x;
+		v->cur_site++;
 
-		if (n->left == NULL)
-		{
-			free(e);
+		vr_bnode_t* n = vr_binbeach_breakAt(&v->front, v->sweepline, r);
+		if (n->parent == NULL)
 			return 1;
-		}
 
 		// insert events
-		push_circle(v, n->left);
-		push_circle(v, n->right->right);
+		push_circle(v, vr_bnode_prev(n));
+		push_circle(v, vr_bnode_next(n));
 
 		// add edge
-		vr_edge_t* f = new_edge(v, n->r1, e->r);
-		n       ->end = &f->s.a;
-		n->right->end = &f->s.b;
+		vr_bnode_t* lb = vr_bnode_right(n);
+		vr_bnode_t* rb = vr_bnode_left (n);
+		vr_edge_t* f = new_edge(v, lb->r1, r);
+		lb->end = &f->s.a;
+		rb->end = &f->s.b;
 	}
 
-	free(e);
 	return 1;
 }
 
@@ -316,6 +387,7 @@ static void vr_diagram_restrictRegion(vr_diagram_t* v, vr_region_t* r)
 	if (a->x == b->x || a->y == b->y)
 	{
 		vr_edge_t* e = new_edge(v, r, NULL);
+		region_addEdge(r, e);
 		e->s.a = a;
 		e->s.b = b;
 		return;
@@ -340,11 +412,41 @@ static void vr_diagram_restrictRegion(vr_diagram_t* v, vr_region_t* r)
 	np->p = p;
 	vr_edge_t* e1 = new_edge(v, r, NULL);
 	vr_edge_t* e2 = new_edge(v, r, NULL);
+	region_addEdge(r, e1);
+	region_addEdge(r, e2);
 	e1->s.a = a;
 	e1->s.b = &np->p;
 	e2->s.a = &np->p;
 	e2->s.b = b;
 }
+// give each region its span of links, in order of creation
+static void link_regions(vr_diagram_t* v)
+{
+	for (size_t i = 0; i < v->n_regions; i++)
+		v->regions[i].n_edges = 0;
+	for (size_t i = 0; i < v->n_edges; i++)
+	{
+		vr_edge_t* e = &v->edges[i];
+		if (e->ra != NULL) e->ra->n_edges++;
+		if (e->rb != NULL) e->rb->n_edges++;
+	}
+
+	vr_edge_t** l = v->links;
+	for (size_t i = 0; i < v->n_regions; i++)
+	{
+		vr_region_t* r = &v->regions[i];
+		r->edges = l;
+		l += r->n_edges + 2;
+		r->n_edges = 0;
+	}
+
+	for (size_t i = 0; i < v->n_edges; i++)
+	{
+		vr_edge_t* e = &v->edges[i];
+		if (e->ra != NULL) region_addEdge(e->ra, e);
+		if (e->rb != NULL) region_addEdge(e->rb, e);
+	}
+}
 void vr_diagram_end(vr_diagram_t* v)
 {
 	while (vr_diagram_step(v));
@@ -352,21 +454,37 @@ void vr_diagram_end(vr_diagram_t* v)
 	v->sweepline += 1000;
 	finishEdges(v, v->front.root);
 
+	link_regions(v);
 	for (size_t i = 0; i < v->n_regions; i++)
-		vr_diagram_restrictRegion(v, v->regions[i]);
+		vr_diagram_restrictRegion(v, &v->regions[i]);
 }
 
-static void vertex_addEdge(vr_vertex_t* p, vr_edge_t* e)
-{
-	p->edges = CALLOC(vr_edge_t*, p->n_edges+1);
-	p->edges[p->n_edges++] = e;
-}
 void vr_diagram_fill(vr_diagram_t* v)
 {
+	for (size_t i = 0; i < v->n_vertices; i++)
+		v->vertices[i].n_edges = 0;
+	for (size_t i = 0; i < v->n_edges; i++)
+	{
+		vr_edge_t* e = &v->edges[i];
+		((vr_vertex_t*) e->s.a)->n_edges++;
+		((vr_vertex_t*) e->s.b)->n_edges++;
+	}
+
+	vr_edge_t** l = v->vlinks;
+	for (size_t i = 0; i < v->n_vertices; i++)
+	{
+		vr_vertex_t* p = &v->vertices[i];
+		p->edges = l;
+		l += p->n_edges;
+		p->n_edges = 0;
+	}
+
 	for (size_t i = 0; i < v->n_edges; i++)
 	{
-		vr_edge_t* e = v->edges[i];
-		vertex_addEdge((vr_vertex_t*) e->s.a, e);
-		vertex_addEdge((vr_vertex_t*) e->s.b, e);
+		vr_edge_t* e = &v->edges[i];
+		vr_vertex_t* a = (vr_vertex_t*) e->s.a;
+		vr_vertex_t* b = (vr_vertex_t*) e->s.b;
+		a->edges[a->n_edges++] = e;
+		b->edges[b->n_edges++] = e;
 	}
 }
@@ -52,41 +52,60 @@ struct vr_region
 	// site
 	point_t p;
 
+	// span of the diagram's links, set by vr_diagram_end()
 	size_t      n_edges;
 	vr_edge_t** edges;
 };
 
+// circle event; site events are read from 'sites' directly
 struct vr_event
 {
-	// 0 if new vertex, 1 if circle
-	char is_circle;
-	char active;
+	// center of the circle
+	point_t c;
 
-	vr_region_t* r;
-
-	// circle info
-	vr_vertex_t* p;
+	// disappearing arc
 	vr_bnode_t* n;
+
+	// position in the event queue
+	size_t pos;
+
+	// next spare event
+	vr_event_t* next;
 };
 
+// all the storage is kept by vr_diagram_reset(), so
+// that rebuilding a diagram does not allocate memory
 struct vr_diagram
 {
 	double width;
 	double height;
 
-	size_t        n_vertices;
-	size_t        a_vertices;
-	vr_vertex_t** vertices;
+	// vertices and edges are reserved once all the sites are
+	// known and never move, since segments point into them
+	size_t       n_vertices;
+	size_t       a_vertices;
+	vr_vertex_t* vertices;
 
-	size_t      n_edges;
-	size_t      a_edges;
-	vr_edge_t** edges;
+	size_t     n_edges;
+	size_t     a_edges;
+	vr_edge_t* edges;
+
+	size_t       n_regions;
+	size_t       a_regions;
+	vr_region_t* regions;
 
-	size_t        n_regions;
-	size_t        a_regions;
-	vr_region_t** regions;
+	// edge lists of the regions and of the vertices
+	size_t      a_links;
+	vr_edge_t** links;
+	vr_edge_t** vlinks;
+
+	// regions sorted by site abscissa, and next one
+	size_t        a_sites;
+	vr_region_t** sites;
+	size_t        cur_site;
 
 	heap_t        events;
+	vr_event_t*   spare_events;
 	vr_binbeach_t front;
 	double        sweepline;
 };
@@ -94,6 +113,10 @@ struct vr_diagram
 void vr_diagram_init(vr_diagram_t* v, double w, double h);
 void vr_diagram_exit(vr_diagram_t* v);
 
+// empty the diagram, keeping its storage
+void vr_diagram_reset(vr_diagram_t* v);
+
+// sites are sorted on the first step, they must all be given before
 void vr_diagram_point (vr_diagram_t* v, point_t p);
 void vr_diagram_points(vr_diagram_t* v, size_t n, point_t* p);
 
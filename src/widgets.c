@@ -119,6 +119,22 @@ void draw_tooltip(graphics_t* gr, assets_t* a, const char* txt)
 	sfRenderWindow_drawText(gr->render, text, NULL);
 }
 
+static void progressbar_colors(float p, char c, sfColor* outline, sfColor* inner)
+{
+	sfColor orange = {255, 42, 42, 255};
+	*outline = c == 1 ? orange : sfWhite;
+
+	     if (c == -1)   *inner = (sfColor){255,255,255,191};
+	else if (c == -2)   *inner = (sfColor){255,255,255,127};
+	else if (c == -3)   *inner = (sfColor){255,  0,  0,191};
+	else if (c == -4)   *inner = (sfColor){  0,  0,255,191};
+	else if (p <= 0.25) *inner = (sfColor){255,  0,  0,191};
+	else if (p <= 0.50) *inner = (sfColor){247,173,  0,191};
+	else if (p <= 0.75) *inner = (sfColor){170,170, 68,191};
+	else if (p <= 1.00) *inner = (sfColor){ 68,255, 68,191};
+	else                *inner = (sfColor){  0,  0,255,191};
+}
+
 void draw_progressbar(graphics_t* gr, float x, float y, float w, float h, float p, char c)
 {
 	static sfRectangleShape* frame    = NULL;
@@ -134,21 +150,11 @@ void draw_progressbar(graphics_t* gr, float x, float y, float w, float h, float
 	float border = 1 + floor(h/20);
 	sfRectangleShape_setOutlineThickness(frame, border);
 
-	// set outline color
-	sfColor orange = {255, 42, 42, 255};
-	sfRectangleShape_setOutlineColor(frame, c == 1 ? orange : sfWhite);
-
-	// set inner color
+	// set colors
+	sfColor outline;
 	sfColor inner;
-	     if (c == -1)   inner = (sfColor){255,255,255,191};
-	else if (c == -2)   inner = (sfColor){255,255,255,127};
-	else if (c == -3)   inner = (sfColor){255,  0,  0,191};
-	else if (c == -4)   inner = (sfColor){  0,  0,255,191};
-	else if (p <= 0.25) inner = (sfColor){255,  0,  0,191};
-	else if (p <= 0.50) inner = (sfColor){247,173,  0,191};
-	else if (p <= 0.75) inner = (sfColor){170,170, 68,191};
-	else if (p <= 1.00) inner = (sfColor){ 68,255, 68,191};
-	else                inner = (sfColor){  0,  0,255,191};
+	progressbar_colors(p, c, &outline, &inner);
+	sfRectangleShape_setOutlineColor(frame, outline);
 	sfRectangleShape_setFillColor(progress, inner);
 
 	// clamp progress
@@ -170,6 +176,26 @@ void draw_progressbar(graphics_t* gr, float x, float y, float w, float h, float
 	sfRenderWindow_drawRectangleShape(gr->render, frame, NULL);
 }
 
+void batch_progressbar(batch_t* b, float x, float y, float w, float h, float p, char c)
+{
+	float border = 1 + floor(h/20);
+
+	sfColor outline;
+	sfColor inner;
+	progressbar_colors(p, c, &outline, &inner);
+
+	p = fmax(fmin(p, 1), 0);
+
+	// the outline goes around the inner rectangle, as for shapes
+	float iw = w - 2*border;
+	float ih = h - 2*border;
+	batch_rect(b, x+border, y+border, iw*p, ih, inner);
+	batch_rect(b, x,          y,          w,      border, outline);
+	batch_rect(b, x,          y+h-border, w,      border, outline);
+	batch_rect(b, x,          y+border,   border, ih,     outline);
+	batch_rect(b, x+w-border, y+border,   border, ih,     outline);
+}
+
 void draw_scrollbar(graphics_t* gr, float x, float y, float w, float h, float r, float p)
 {
 	static sfRectangleShape* cursor = NULL;
@@ -35,6 +35,7 @@ void draw_tooltip  (graphics_t* gr, assets_t* a, const char* txt);
 //      -3                         red (attack)
 //      -4                         blue (defense)
 void draw_progressbar(graphics_t* gr, float x, float y, float w, float h, float p, char c);
+void batch_progressbar(batch_t*    b,  float x, float y, float w, float h, float p, char c);
 
 // h is the total height of the scroll bar
 // r is the proportion the marker should occupy
@@ -0,0 +1,173 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "aisched.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include "world.h"
+
+void aisched_init(aisched_t* s, int budget)
+{
+	s->clock = sfClock_create();
+	s->budget = budget;
+	s->cursor = 0;
+	s->has_focus = 0;
+	s->focus_x = 0;
+	s->focus_y = 0;
+	s->n_queued = 0;
+	s->n_deferred = 0;
+	s->n_skipped = 0;
+	s->report = 0;
+}
+
+void aisched_exit(aisched_t* s)
+{
+	sfClock_destroy(s->clock);
+}
+
+void aisched_focus(aisched_t* s, float x, float y)
+{
+	s->has_focus = 1;
+	s->focus_x = x;
+	s->focus_y = y;
+}
+
+static character_t* bot(object_t* o)
+{
+	if (o->t != O_CHARACTER)
+		return NULL;
+	character_t* c = (character_t*) o;
+	return c->alive && c->ai != NULL ? c : NULL;
+}
+
+// near the focus, fighting or hurt
+static char urgent(aisched_t* s, character_t* c)
+{
+	if (c->attack)
+		return 1;
+	if (c->statuses[ST_HEALTH] < character_maxOfStatus(c, ST_HEALTH))
+		return 1;
+	if (!s->has_focus)
+		return 0;
+	float dx = c->o.x - s->focus_x;
+	float dy = c->o.y - s->focus_y;
+	return dx*dx + dy*dy < AISCHED_FOCUS*AISCHED_FOCUS;
+}
+
+// a bot walking to its target keeps its last intent for a while
+static char needed(character_t* c)
+{
+	if (c->ai_data.idle >= AISCHED_MAXIDLE)
+		return 1;
+
+	float go_x = c->go_x;
+	float go_y = c->go_y;
+	object_t* o = pool_get(&c->w->objects, c->go_o);
+	if (o != NULL)
+	{
+		go_x = o->x;
+		go_y = o->y;
+		if (o->t == O_BUILDING)
+		{
+			building_t* b = (building_t*) o;
+			go_x += b->t->door_dx;
+			go_y += b->t->door_dy;
+		}
+	}
+	return go_x == c->o.x && go_y == c->o.y;
+}
+
+static void decide(character_t* c)
+{
+	ai_do(c->ai, c);
+	c->ai_data.idle = 0;
+}
+
+void aisched_doRound(aisched_t* s, world_t* w, float duration)
+{
+	pool_t* p = &w->objects;
+	size_t n = p->n_objects;
+	if (n == 0)
+		return;
+
+	// no limit: every bot decides every round
+	if (s->budget <= 0)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			character_t* c = bot(p->objects[i]);
+			if (c != NULL)
+				decide(c);
+		}
+		s->n_queued = 0;
+		return;
+	}
+
+	sfClock_restart(s->clock);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		character_t* c = bot(p->objects[i]);
+		if (c == NULL)
+			continue;
+		c->ai_data.idle += duration;
+		if (urgent(s, c))
+			decide(c);
+	}
+
+	// round-robin on the others until the budget is spent
+	size_t start = s->cursor;
+	size_t k = 0;
+	for (; k < n; k++)
+	{
+		character_t* c = bot(p->objects[(start + k) % n]);
+		if (c == NULL || c->ai_data.idle == 0)
+			continue;
+		if (!needed(c))
+		{
+			s->n_skipped++;
+			continue;
+		}
+		if (sfTime_asMicroseconds(sfClock_getElapsedTime(s->clock)) >= s->budget)
+			break;
+		decide(c);
+	}
+	s->cursor = (start + k) % n;
+
+	s->n_queued = 0;
+	for (; k < n; k++)
+	{
+		character_t* c = bot(p->objects[(start + k) % n]);
+		if (c != NULL && c->ai_data.idle != 0 && needed(c))
+			s->n_queued++;
+	}
+	s->n_deferred += s->n_queued;
+
+	s->report += duration;
+	if (s->report >= 1)
+	{
+		if (w->settings->verbosity >= 3)
+			fprintf(stderr, "AI: %i queued, %u deferred and %u skipped in the last second\n",
+				s->n_queued, (unsigned) s->n_deferred, (unsigned) s->n_skipped);
+		s->n_deferred = 0;
+		s->n_skipped = 0;
+		s->report = 0;
+	}
+}
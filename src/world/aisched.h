@@ -0,0 +1,59 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef W_AISCHED_H
+#define W_AISCHED_H
+
+typedef struct aisched aisched_t;
+
+#include <SFML/System.h>
+
+struct world;
+struct character;
+
+// bots closer than this to the focus always decide (in world units)
+#define AISCHED_FOCUS 640
+// bots walking to their target decide at least this often (in seconds)
+#define AISCHED_MAXIDLE 1.0
+
+// spreads bot decisions across rounds under a time budget
+struct aisched
+{
+	sfClock* clock;
+	int budget; // in microseconds per round, 0 for no limit
+
+	size_t cursor; // next object of the round-robin
+
+	char  has_focus;
+	float focus_x;
+	float focus_y;
+
+	// statistics
+	int    n_queued;   // bots left waiting at the end of last round
+	size_t n_deferred; // decisions postponed to a later round, since the last report
+	size_t n_skipped;  // decisions which were not needed, since the last report
+	float  report;     // time since the last report
+};
+
+void aisched_init(aisched_t* s, int budget);
+void aisched_exit(aisched_t* s);
+
+void aisched_focus  (aisched_t* s, float x, float y);
+void aisched_doRound(aisched_t* s, struct world* w, float duration);
+
+#endif
@@ -112,6 +112,8 @@ void building_update(building_t* b)
 			open = 1;
 	}
 	b->open = open;
+
+	market_update(&b->w->market, b);
 }
 
 void building_take(building_t* b, char is_item, int id, float amount, inventory_t* inv, char isOwner)
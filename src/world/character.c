@@ -18,6 +18,7 @@
 
 #include "character.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "../math.h"
@@ -45,6 +46,7 @@ void character_init(character_t* c, world_t* w, kindOf_character_t* t)
 
 	c->ai = NULL;
 	memset(&c->ai_data, 0, sizeof(ai_data_t));
+	ai_cache_init(&c->ai_cache);
 
 	universe_t* u = w->universe;
 
@@ -73,6 +75,7 @@ void character_exit(character_t* c)
 	if (c == NULL)
 		return;
 
+	ai_cache_exit(&c->ai_cache);
 	free(c->equipment);
 	free(c->skills);
 	inventory_exit(&c->inventory);
@@ -314,8 +317,8 @@ char character_buildAuto(character_t* c, kindOf_building_t* t)
 	float max = sqrt(w*w + h*h) * 1.5;
 	for (float radius = 50; radius < max; radius *= 1.5)
 	{
-		float x = c->o.x + cfrnd(radius);
-		float y = c->o.y + cfrnd(radius);
+		float x = c->o.x + rng_cfloat(&c->w->rng[RNG_AI], radius);
+		float y = c->o.y + rng_cfloat(&c->w->rng[RNG_AI], radius);
 
 		if (character_buildAt(c, t, x, y))
 			return 1;
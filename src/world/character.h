@@ -46,8 +46,9 @@ struct character
 	float       attackDelay;
 	char        inWater;
 
-	ai_t*     ai;
-	ai_data_t ai_data;
+	ai_t*      ai;
+	ai_data_t  ai_data;
+	ai_cache_t ai_cache;
 
 	inventory_t inventory;
 	uuid_t hasBuilding;
@@ -294,11 +294,6 @@ void character_doRound(character_t* c, float duration)
 	if (!c->alive)
 		return;
 
-	if (c->ai != NULL)
-	{
-		ai_do(c->ai, c);
-	}
-
 	c->attackDelay = fmax(c->attackDelay - duration, 0);
 
 	duration *= character_vitality(c);
@@ -35,12 +35,19 @@ void chunk_init(chunk_t* c, world_t* w, float x, float y, int rows, int cols)
 
 	c->rows = rows;
 	c->cols = cols;
-	c->lands = CALLOC(short, rows*cols);
+	c->lands = NULL;
+	c->meshed = 0;
+	c->baked = NULL;
+	c->baked_size = 0;
+	c->stale = 0;
+	c->tone = -1;
+	if (!w->lazy)
+		chunk_load(c);
 
-	c->water_step = 0;
-	c->array = sfVertexArray_create();
-	sfVertexArray_setPrimitiveType(c->array, sfQuads);
-	sfVertexArray_resize(c->array, rows*cols*4);
+	c->generated = 0;
+	c->swapped = 0;
+	for (int k = 0; k < LRU_LISTS; k++)
+		c->lru[k] = (lru_link_t){NULL, NULL};
 
 	c->n_mines = 0;
 	c->mines = NULL;
@@ -52,55 +59,218 @@ void chunk_init(chunk_t* c, world_t* w, float x, float y, int rows, int cols)
 void chunk_exit(chunk_t* c)
 {
 	free(c->mines);
-	sfVertexArray_destroy(c->array);
+	chunk_freeMesh(c);
+	chunk_freeBaked(c);
+	chunk_unload(c);
+}
+
+void chunk_load(chunk_t* c)
+{
+	c->lands = CALLOC(short, c->rows*c->cols);
+}
+
+void chunk_unload(chunk_t* c)
+{
 	free(c->lands);
+	c->lands = NULL;
 }
 
-void chunk_update(chunk_t* c)
+static void quad(sfVertex* v, float x, float y, int t)
 {
-	for (int i = 0; i < c->rows; i++)
-		for (int j = 0; j < c->cols; j++)
-		{
-			sfVertex* v = sfVertexArray_getVertex(c->array, (i*c->cols+j)*4);
+	v[0].position = (sfVector2f){x+ 0,y+ 0};
+	v[1].position = (sfVector2f){x+16,y+ 0};
+	v[2].position = (sfVector2f){x+16,y+16};
+	v[3].position = (sfVector2f){x+ 0,y+16};
 
-			float a = c->o.x + (j-.5*c->cols)*16;
-			float b = c->o.y + (i-   c->rows)*16;
-			v[0].position = (sfVector2f){a+ 0,b+ 0};
-			v[1].position = (sfVector2f){a+16,b+ 0};
-			v[2].position = (sfVector2f){a+16,b+16};
-			v[3].position = (sfVector2f){a+ 0,b+16};
+	for (int k = 0; k < 4; k++)
+		v[k].color = sfWhite;
 
-			for (int k = 0; k < 4; k++)
-				v[k].color = sfWhite;
+	float a = 16*(t%16);
+	float b = 16*(t/16);
+	v[0].texCoords = (sfVector2f){a+ 0.01,b+ 0.01};
+	v[1].texCoords = (sfVector2f){a+15.99,b+ 0.01};
+	v[2].texCoords = (sfVector2f){a+15.99,b+15.99};
+	v[3].texCoords = (sfVector2f){a+ 0.01,b+15.99};
+}
 
-			int t = LAND(c,i,j);
-			a = 16*(t%16);
-			b = 16*(t/16);
-			v[0].texCoords = (sfVector2f){a+ 0.01,b+ 0.01};
-			v[1].texCoords = (sfVector2f){a+15.99,b+ 0.01};
-			v[2].texCoords = (sfVector2f){a+15.99,b+15.99};
-			v[3].texCoords = (sfVector2f){a+ 0.01,b+15.99};
+// takes ownership of the vertices
+static void mesh_init(mesh_t* m, sfVertex* v, unsigned int n)
+{
+	m->n_vertices = n;
+	m->buffer = NULL;
+	m->vertices = NULL;
+	if (n == 0)
+	{
+		free(v);
+		return;
+	}
+
+	if (sfVertexBuffer_isAvailable())
+	{
+		m->buffer = sfVertexBuffer_create(n, sfQuads, sfVertexBufferStatic);
+		if (m->buffer != NULL && sfVertexBuffer_update(m->buffer, v, n, 0))
+		{
+			free(v);
+			return;
 		}
+		if (m->buffer != NULL)
+			sfVertexBuffer_destroy(m->buffer);
+		m->buffer = NULL;
+	}
+	m->vertices = v;
 }
 
-void chunk_updwtr(chunk_t* c)
+static void mesh_exit(mesh_t* m)
+{
+	if (m->buffer != NULL)
+		sfVertexBuffer_destroy(m->buffer);
+	free(m->vertices);
+}
+
+void chunk_update(chunk_t* c)
 {
-	int step = c->water_step == 3 ? 1 : c->water_step;
+	chunk_freeMesh(c);
+
+	size_t n_water = 0;
+	for (int k = 0; k < c->rows*c->cols; k++)
+		n_water += c->lands[k]/16 == 10;
+	size_t n_terrain = c->rows*c->cols - n_water;
+	c->slots = CALLOC(short, c->rows*c->cols);
+	c->dirty = CALLOC(uint32_t, (c->rows*c->cols + 31) / 32);
+	memset(c->dirty, 0, sizeof(uint32_t) * ((c->rows*c->cols + 31) / 32));
+	c->n_dirty = 0;
+
+	sfVertex* terrain = CALLOC(sfVertex, 4*n_terrain);
+	sfVertex* water[WATER_STEPS];
+	for (int s = 0; s < WATER_STEPS; s++)
+		water[s] = CALLOC(sfVertex, 4*n_water);
+
+	// water tiles have their animation frames below them
+	size_t k = 0;
+	size_t l = 0;
 	for (int i = 0; i < c->rows; i++)
 		for (int j = 0; j < c->cols; j++)
 		{
+			float x = c->o.x + (j-.5*c->cols)*16;
+			float y = c->o.y + (i-   c->rows)*16;
 			int t = LAND(c,i,j);
 			if (t/16 != 10)
+			{
+				c->slots[i*c->cols+j] = k;
+				quad(&terrain[4*k++], x, y, t);
 				continue;
-			t += 16*step;
-			float a = 16*(t%16);
-			float b = 16*(t/16);
-			sfVertex* v = sfVertexArray_getVertex(c->array, (i*c->cols+j)*4);
-			v[0].texCoords = (sfVector2f){a+ 0.01,b+ 0.01};
-			v[1].texCoords = (sfVector2f){a+15.99,b+ 0.01};
-			v[2].texCoords = (sfVector2f){a+15.99,b+15.99};
-			v[3].texCoords = (sfVector2f){a+ 0.01,b+15.99};
+			}
+			c->slots[i*c->cols+j] = -1-l;
+			for (int s = 0; s < WATER_STEPS; s++)
+				quad(&water[s][4*l], x, y, t + 16*s);
+			l++;
+		}
+
+	mesh_init(&c->terrain, terrain, 4*n_terrain);
+	for (int s = 0; s < WATER_STEPS; s++)
+		mesh_init(&c->water[s], water[s], 4*n_water);
+	c->meshed = 1;
+}
+
+void chunk_freeMesh(chunk_t* c)
+{
+	if (!c->meshed)
+		return;
+	mesh_exit(&c->terrain);
+	for (int s = 0; s < WATER_STEPS; s++)
+		mesh_exit(&c->water[s]);
+	free(c->dirty);
+	free(c->slots);
+	c->meshed = 0;
+}
+
+void chunk_setDirty(chunk_t* c, int i, int j)
+{
+	c->stale = 1;
+	c->tone = -1;
+	if (!c->meshed)
+		return;
+	int k = i*c->cols + j;
+	uint32_t bit = (uint32_t) 1 << (k%32);
+	if (!(c->dirty[k/32] & bit))
+	{
+		c->dirty[k/32] |= bit;
+		c->n_dirty++;
+	}
+}
+
+static void mesh_patch(mesh_t* m, size_t slot, const sfVertex* v)
+{
+	if (m->buffer != NULL)
+		sfVertexBuffer_update(m->buffer, v, 4, 4*slot);
+	else
+		memcpy(&m->vertices[4*slot], v, 4*sizeof(sfVertex));
+}
+
+void chunk_patch(chunk_t* c)
+{
+	if (!c->meshed || c->n_dirty == 0)
+		return;
+
+	// a tile going in or out of water changes the layout of the meshes
+	int n = c->rows*c->cols;
+	for (int k = 0; k < n; k++)
+	{
+		char dirty = (c->dirty[k/32] >> (k%32)) & 1;
+		if (dirty && (c->slots[k] < 0) != (c->lands[k]/16 == 10))
+		{
+			chunk_update(c);
+			return;
+		}
+	}
+
+	for (int k = 0; k < n; k++)
+	{
+		if (((c->dirty[k/32] >> (k%32)) & 1) == 0)
+			continue;
+		int i = k / c->cols;
+		int j = k % c->cols;
+		float x = c->o.x + (j-.5*c->cols)*16;
+		float y = c->o.y + (i-   c->rows)*16;
+		int t = c->lands[k];
+		sfVertex v[4];
+		if (c->slots[k] >= 0)
+		{
+			quad(v, x, y, t);
+			mesh_patch(&c->terrain, c->slots[k], v);
+			continue;
+		}
+		for (int s = 0; s < WATER_STEPS; s++)
+		{
+			quad(v, x, y, t + 16*s);
+			mesh_patch(&c->water[s], -1-c->slots[k], v);
 		}
+	}
+	memset(c->dirty, 0, sizeof(uint32_t) * ((n+31) / 32));
+	c->n_dirty = 0;
+}
+
+void chunk_freeBaked(chunk_t* c)
+{
+	if (c->baked != NULL)
+		sfTexture_destroy(c->baked);
+	c->baked = NULL;
+	c->baked_size = 0;
+}
+
+short chunk_tone(chunk_t* c)
+{
+	if (c->tone >= 0 || c->lands == NULL)
+		return c->tone < 0 ? 0 : c->tone;
+
+	int count[16] = {0};
+	for (int k = 0; k < c->rows*c->cols; k++)
+		count[(c->lands[k]/16) % 16]++;
+	c->tone = 0;
+	for (int t = 1; t < 16; t++)
+		if (count[t] > count[c->tone])
+			c->tone = t;
+	return c->tone;
 }
 
 void chunk_pushMine(chunk_t* c, mine_t* m)
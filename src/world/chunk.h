@@ -21,6 +21,23 @@
 
 typedef struct chunk chunk_t;
 
+// the world keeps the chunks holding some resource in lists
+// ordered by last use, so as to drop the oldest ones
+typedef enum
+{
+	LRU_TILES,  // in a streaming world
+	LRU_MESHES, // vertices of visible chunks
+	LRU_BAKED,  // textures of chunks seen from afar
+	LRU_LISTS,
+} lru_kind_t;
+
+typedef struct
+{
+	chunk_t* prev;
+	chunk_t* next;
+} lru_link_t;
+
+#include <stdint.h>
 #include <SFML/Graphics.h>
 
 #include "object.h"
@@ -31,6 +48,18 @@ typedef struct chunk chunk_t;
 #define TILE_SIZE 16
 #define LAND(C,I,J) ((C)->lands[(I)*(C)->cols + (J)])
 
+// frames of the water animation
+#define WATER_STEPS 3
+
+// quads uploaded once; without vertex buffers,
+// they are drawn from memory
+typedef struct
+{
+	unsigned int n_vertices;
+	sfVertexBuffer* buffer;
+	sfVertex* vertices;
+} mesh_t;
+
 struct chunk
 {
 	object_t o;
@@ -38,10 +67,25 @@ struct chunk
 
 	int rows;
 	int cols;
-	short* lands;
+	short* lands; // NULL when not resident
+
+	// built when shown, water apart
+	char   meshed;
+	mesh_t terrain;
+	mesh_t water[WATER_STEPS];
+	short* slots;    // quad of each tile in its mesh, -1-k for water
+	uint32_t* dirty; // tiles changed since, one bit each
+	size_t n_dirty;
+
+	// lands rendered once to a texture, for views from afar
+	sfTexture* baked;
+	unsigned int baked_size;
+	char stale;  // lands changed since
+	short tone;  // most common land type, -1 if unknown
 
-	int water_step;
-	sfVertexArray* array; // TODO :(
+	char generated; // mines have been placed
+	char swapped;   // tiles are in the swap file
+	lru_link_t lru[LRU_LISTS];
 
 	size_t n_mines;
 	mine_t** mines;
@@ -53,8 +97,20 @@ struct chunk
 void chunk_init(chunk_t* c, world_t* w, float x, float y, int rows, int cols);
 void chunk_exit(chunk_t* c);
 
-void chunk_update(chunk_t* c);
-void chunk_updwtr(chunk_t* c);
+// allocate or free the tiles, keeping objects
+void chunk_load  (chunk_t* c);
+void chunk_unload(chunk_t* c);
+
+// build the meshes from the tiles, or free them
+void chunk_update  (chunk_t* c);
+void chunk_freeMesh(chunk_t* c);
+
+// mark a tile as changed, and update the quads of the marked tiles
+void chunk_setDirty(chunk_t* c, int i, int j);
+void chunk_patch   (chunk_t* c);
+
+void  chunk_freeBaked(chunk_t* c);
+short chunk_tone     (chunk_t* c);
 
 void chunk_pushMine(chunk_t* c, mine_t* m);
 
@@ -0,0 +1,347 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "chunkgen.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../mem.h"
+#include "../voronoi/geometry.h"
+
+// sites per chunk side
+#define CELLS_GRID 9
+
+// noise wavelengths, in tiles
+#define NOISE_SCALE   96.f // largest elevation features
+#define NOISE_WARP    32.f // domain warp amplitude
+#define NOISE_OCTAVES 4
+#define NOISE_ORIGIN  1024 // keeps sample coordinates positive
+#define NOISE_STEP    4    // tiles between samples of smooth fields
+
+typedef struct
+{
+	short t;
+	float x;
+	float y;
+	float d; // squared radius
+} biome_t;
+
+void chunkgen_rng(world_t* w, rng_t* r, int ci, int cj, int kind)
+{
+	int idx = (ci+2) * (w->chunk_cols+4) + (cj+2);
+	rng_seed(r, w->seed, RNG_STREAMS + 3*idx + kind);
+}
+
+// append the biomes of a chunk, drawn as in region_types()
+static void cells_biomes(world_t* w, int ci, int cj, int ch, int cw, biome_t* b, size_t* n)
+{
+	static const float land_probas[] = {0, 0.25, 0.25, 0.2, 0.05, 0,0,0,0,0,0.25};
+	alias_t pick;
+	alias_init(&pick, sizeof(land_probas)/sizeof(float), land_probas);
+
+	rng_t r;
+	chunkgen_rng(w, &r, ci, cj, CHUNKGEN_BIOMES);
+	int k = ch*cw / 1000.f + rng_float(&r, 0, 1);
+	for (; k > 0; k--)
+	{
+		biome_t* o = &b[(*n)++];
+		o->t = alias_pick(&pick, &r);
+		o->x = ci*ch + rng_float(&r, 0, ch);
+		o->y = cj*cw + rng_float(&r, 0, cw);
+		o->d = rng_float(&r, 5, 10);
+		o->d *= o->d;
+	}
+
+	alias_exit(&pick);
+}
+
+// map borders count as same land; 'type' covers the chunk
+// and a margin of one tile, and is freed
+static void finish(world_t* w, chunk_t* c, short* type)
+{
+	int ch = c->rows;
+	int cw = c->cols;
+	int ci = (c - w->chunks) / w->chunk_cols;
+	int cj = (c - w->chunks) % w->chunk_cols;
+	int stride = cw+2;
+
+	if (ci == 0)
+		for (int j = 0; j < stride; j++)
+			type[j] = type[stride+j];
+	if (ci == w->chunk_rows-1)
+		for (int j = 0; j < stride; j++)
+			type[(ch+1)*stride+j] = type[ch*stride+j];
+	if (cj == 0)
+		for (int i = 0; i < ch+2; i++)
+			type[i*stride] = type[i*stride+1];
+	if (cj == w->chunk_cols-1)
+		for (int i = 0; i < ch+2; i++)
+			type[i*stride+cw+1] = type[i*stride+cw];
+
+	for (int i = 0; i < ch; i++)
+		chunkgen_borders(&LAND(c,i,0), &type[(i+1)*stride+1], stride, cw);
+	free(type);
+}
+
+void chunkgen_cells(world_t* w, chunk_t* c)
+{
+	int ch = c->rows;
+	int cw = c->cols;
+	int ci = (c - w->chunks) / w->chunk_cols;
+	int cj = (c - w->chunks) % w->chunk_cols;
+
+	// biomes reach less than a chunk away, and later ones
+	// overwrite earlier ones; keep the order of the chunks
+	size_t n_biomes = 0;
+	biome_t* biomes = CALLOC(biome_t, 25 * (ch*cw/1000 + 1));
+	for (int a = -2; a <= 2; a++)
+	for (int b = -2; b <= 2; b++)
+		cells_biomes(w, ci+a, cj+b, ch, cw, biomes, &n_biomes);
+
+	// sites of the 3x3 chunks around, one per cell of the grid
+	int G = CELLS_GRID;
+	int n = 3*G;
+	point_t* sites = CALLOC(point_t, n*n);
+	short*   types = CALLOC(short,   n*n);
+	for (int a = 0; a < 3; a++)
+	for (int b = 0; b < 3; b++)
+	{
+		rng_t r;
+		chunkgen_rng(w, &r, ci+a-1, cj+b-1, CHUNKGEN_SITES);
+		for (int u = 0; u < G; u++)
+		for (int v = 0; v < G; v++)
+		{
+			float x = (ci+a-1)*ch + (u + rng_float(&r, 0, 1)) * ch / G;
+			float y = (cj+b-1)*cw + (v + rng_float(&r, 0, 1)) * cw / G;
+			int k = (a*G+u)*n + b*G+v;
+			sites[k] = (point_t){x,y};
+			types[k] = 0;
+			for (size_t l = 0; l < n_biomes; l++)
+			{
+				biome_t* o = &biomes[l];
+				float dx = o->x - x;
+				float dy = o->y - y;
+				if (dx*dx + dy*dy < o->d)
+					types[k] = o->t;
+			}
+		}
+	}
+	free(biomes);
+
+	// label the tiles and a margin of one tile; the nearest
+	// site lies at most two cells away from that of the tile
+	int stride = cw+2;
+	short* type = CALLOC(short, (ch+2)*stride);
+	for (int i = -1; i <= ch; i++)
+	for (int j = -1; j <= cw; j++)
+	{
+		double x = ci*ch + i;
+		double y = cj*cw + j;
+		int gu = (i+ch) * G / ch;
+		int gv = (j+cw) * G / cw;
+		double best_d = -1;
+		short best = 0;
+		for (int u = gu-2; u <= gu+2; u++)
+		for (int v = gv-2; v <= gv+2; v++)
+		{
+			if (u < 0 || u >= n || v < 0 || v >= n)
+				continue;
+			point_t p = sites[u*n+v];
+			double d = (p.x-x)*(p.x-x) + (p.y-y)*(p.y-y);
+			if (best_d < 0 || d < best_d)
+			{
+				best = types[u*n+v];
+				best_d = d;
+			}
+		}
+		type[(i+1)*stride + j+1] = best;
+	}
+	free(types);
+	free(sites);
+
+	finish(w, c, type);
+}
+
+// lattice point to [0,1), from the products of its coordinates
+static inline float lattice(uint32_t seed, uint32_t hx, uint32_t hy)
+{
+	uint32_t h = seed ^ hx ^ hy;
+	h = (h ^ (h >> 16)) * 0x7feb352du;
+	h = (h ^ (h >> 15)) * 0x846ca68bu;
+	h = h ^ (h >> 16);
+	return (h >> 8) * (1.f / (1 << 24));
+}
+
+// add value noise of frequency f at the given points; a flat
+// loop over a row, without branches, that the compiler vectorizes
+static void noise_add(float* restrict dst, const float* restrict x, const float* restrict y,
+                      int n, uint32_t seed, float f, float amp)
+{
+	const uint32_t A = 0x8da6b343u;
+	const uint32_t B = 0xd8163841u;
+	for (int k = 0; k < n; k++)
+	{
+		float u = x[k] * f;
+		float v = y[k] * f;
+		int32_t iu = (int32_t) u; // positive, so this floors
+		int32_t iv = (int32_t) v;
+		float tu = u - iu;
+		float tv = v - iv;
+		tu = tu*tu*(3-2*tu);
+		tv = tv*tv*(3-2*tv);
+		uint32_t hu = (uint32_t) iu * A;
+		uint32_t hv = (uint32_t) iv * B;
+		float a = lattice(seed, hu,   hv);
+		float b = lattice(seed, hu+A, hv);
+		float c = lattice(seed, hu,   hv+B);
+		float d = lattice(seed, hu+A, hv+B);
+		float top    = a + (b-a)*tu;
+		float bottom = c + (d-c)*tu;
+		dst[k] += amp * (top + (bottom-top)*tv);
+	}
+}
+
+// sum of octaves, normalized to [0,1)
+static void fbm(float* dst, const float* x, const float* y, int n, uint32_t seed, float f, int octaves)
+{
+	for (int k = 0; k < n; k++)
+		dst[k] = 0;
+	float amp = 1;
+	float total = 0;
+	for (int o = 0; o < octaves; o++)
+	{
+		noise_add(dst, x, y, n, seed + o, f, amp);
+		total += amp;
+		f *= 2;
+		amp /= 2;
+	}
+	for (int k = 0; k < n; k++)
+		dst[k] /= total;
+}
+
+// land type from elevation and moisture
+static inline short noise_class(float e, float m)
+{
+	return e < .36f ? 10 : // water
+	       e < .39f ?  2 : // sand along the shores
+	       e > .70f ?  4 : // mountains
+	       e > .63f ?  3 : // hills
+	       m < .33f ?  1 : // dry land
+	                   0;
+}
+
+// bilinear interpolation of a field sampled every NOISE_STEP tiles,
+// for the tiles of row i and columns -1 to n-2 of the chunk
+static void smooth_row(float* dst, const float* g, int gn, int i, int n)
+{
+	int a = (i + NOISE_STEP) / NOISE_STEP;
+	float t = (float) ((i + NOISE_STEP) % NOISE_STEP) / NOISE_STEP;
+	const float* lo = &g[a*gn];
+	const float* hi = lo + gn;
+	float col[gn];
+	for (int b = 0; b < gn; b++)
+		col[b] = lo[b] + (hi[b]-lo[b])*t;
+
+	// from column -NOISE_STEP
+	float row[(gn-1)*NOISE_STEP];
+	for (int b = 0; b < gn-1; b++)
+		for (int s = 0; s < NOISE_STEP; s++)
+			row[b*NOISE_STEP + s] = col[b] + (col[b+1]-col[b]) * s / NOISE_STEP;
+	memcpy(dst, row + NOISE_STEP-1, sizeof(float)*n);
+}
+
+void chunkgen_noise(world_t* w, chunk_t* c)
+{
+	int ch = c->rows;
+	int cw = c->cols;
+	int ci = (c - w->chunks) / w->chunk_cols;
+	int cj = (c - w->chunks) % w->chunk_cols;
+
+	// the same for every chunk
+	rng_t r;
+	rng_seed(&r, w->seed, RNG_TERRAIN);
+	uint32_t s_warpx = rng_next(&r);
+	uint32_t s_warpy = rng_next(&r);
+	uint32_t s_elev  = rng_next(&r);
+	uint32_t s_moist = rng_next(&r);
+
+	// the warp and the moisture are smooth, sample them on a grid aligned
+	// on the map, so that neighbour chunks agree; it covers the margin
+	int gm = ch/NOISE_STEP + 3;
+	int gn = cw/NOISE_STEP + 3;
+	float* gwx = CALLOC(float, 3*gm*gn);
+	float* gwy = gwx + gm*gn;
+	float* gmo = gwy + gm*gn;
+	float gx[gn], gy[gn];
+	for (int a = 0; a < gm; a++)
+	{
+		for (int b = 0; b < gn; b++)
+		{
+			gx[b] = NOISE_ORIGIN + ci*ch + (a-1)*NOISE_STEP;
+			gy[b] = NOISE_ORIGIN + cj*cw + (b-1)*NOISE_STEP;
+		}
+		fbm(&gwx[a*gn], gx, gy, gn, s_warpx, 1/NOISE_SCALE, 2);
+		fbm(&gwy[a*gn], gx, gy, gn, s_warpy, 1/NOISE_SCALE, 2);
+		fbm(&gmo[a*gn], gx, gy, gn, s_moist, 2/NOISE_SCALE, 2);
+	}
+
+	// one row at a time, with a margin of one tile
+	int n = cw+2;
+	float wx[n], wy[n], e[n], m[n];
+	short* type = CALLOC(short, (ch+2)*n);
+	for (int i = -1; i <= ch; i++)
+	{
+		// elevation is sampled through the warp
+		smooth_row(wx, gwx, gn, i, n);
+		smooth_row(wy, gwy, gn, i, n);
+		for (int j = 0; j < n; j++)
+		{
+			wx[j] = NOISE_ORIGIN + ci*ch + i   + NOISE_WARP * (2*wx[j]-1);
+			wy[j] = NOISE_ORIGIN + cj*cw + j-1 + NOISE_WARP * (2*wy[j]-1);
+		}
+		fbm(e, wx, wy, n, s_elev, 1/NOISE_SCALE, NOISE_OCTAVES);
+		smooth_row(m, gmo, gn, i, n);
+
+		short* t = &type[(i+1)*n];
+		for (int j = 0; j < n; j++)
+			t[j] = noise_class(e[j], m[j]);
+	}
+	free(gwx);
+
+	finish(w, c, type);
+}
+
+void chunkgen_borders(short* dst, const short* type, int stride, int n)
+{
+	static const char type2tile[16] = {0,5,2,13,4,7,12,8,3,15,6,11,14,9,10,1};
+
+	const short* top    = type - stride;
+	const short* bottom = type + stride;
+	char mask[n];
+	for (int j = 0; j < n; j++)
+	{
+		short t = type[j];
+		mask[j] = (t == top[j])     << 3
+		        | (t == type[j+1])  << 2
+		        | (t == bottom[j])  << 1
+		        | (t == type[j-1])  << 0;
+	}
+	for (int j = 0; j < n; j++)
+		dst[j] = type[j] == 0 ? 0 : 16*type[j] + type2tile[(int) mask[j]];
+}
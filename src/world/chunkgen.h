@@ -0,0 +1,46 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef W_CHUNKGEN_H
+#define W_CHUNKGEN_H
+
+#include "world.h"
+#include "chunk.h"
+
+// random streams of a chunk
+#define CHUNKGEN_SITES  0
+#define CHUNKGEN_BIOMES 1
+#define CHUNKGEN_MINES  2
+
+// the stream of a chunk only depends on the seed and on the position of
+// the chunk, which may lie up to two chunks outside the map
+void chunkgen_rng(world_t* w, rng_t* r, int ci, int cj, int kind);
+
+// Voronoi cells around sites jittered on a grid, so that the tiles of a
+// chunk only depend on its neighbours and can be generated in any order
+void chunkgen_cells(world_t* w, chunk_t* c);
+
+// warped value noise, classified by elevation and moisture; each
+// tile only depends on its position
+void chunkgen_noise(world_t* w, chunk_t* c);
+
+// border tiles from land types; 'type' points into a grid with the given
+// stride and a one tile margin, where the map borders are repeated
+void chunkgen_borders(short* dst, const short* type, int stride, int n);
+
+#endif
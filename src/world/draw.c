@@ -19,17 +19,18 @@
 #include "draw.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#include "../mem.h"
 #include "../widgets.h"
 
-static void draw_object(graphics_t* g, assets_t* a, object_t* o, sfSprite* sprite)
+static void draw_object(graphics_t* g, assets_t* a, object_t* o, sfSprite* sprite, sfIntRect rect)
 {
 	(void) a;
 
 	sfVector2f pos = {o->x - o->w/2, o->y - o->h};
-	sfSprite_setPosition(sprite, pos);
-	sfRenderWindow_drawSprite(g->render, sprite, NULL);
+	batch_sprite(&g->batch, sfSprite_getTexture(sprite), rect, pos, sfWhite);
 }
 
 void draw_event(graphics_t* g, assets_t* a, character_t* player, event_t* e)
@@ -49,12 +50,9 @@ void draw_event(graphics_t* g, assets_t* a, character_t* player, event_t* e)
 
 	sfIntRect rect = {0, 0, t->width, t->height};
 	rect.left = t->width * step;
-	sfSprite_setTextureRect(sprite, rect);
 
 	sfVector2f pos = {e->x - t->width/2, e->y - t->height/2};
-	sfSprite_setPosition(sprite, pos);
-
-	sfRenderWindow_drawSprite(g->render, sprite, NULL);
+	batch_sprite(&g->batch, sfSprite_getTexture(sprite), rect, pos, sfWhite);
 }
 
 void draw_projectile(graphics_t* g, assets_t* a, character_t* player, projectile_t* p)
@@ -74,10 +72,7 @@ void draw_projectile(graphics_t* g, assets_t* a, character_t* player, projectile
 	float h = p->t->height;
 	sfIntRect  rect = {w*step, h*p->dir, w, h};
 	sfVector2f pos  = {p->o.x - p->o.w/2, p->o.y - p->o.h};
-
-	sfSprite_setTextureRect(sprite, rect);
-	sfSprite_setPosition(sprite, pos);
-	sfRenderWindow_drawSprite(g->render, sprite, NULL);
+	batch_sprite(&g->batch, sfSprite_getTexture(sprite), rect, pos, sfWhite);
 }
 
 void draw_character(graphics_t* g, assets_t* a, character_t* player, character_t* c)
@@ -103,20 +98,8 @@ void draw_character(graphics_t* g, assets_t* a, character_t* player, character_t
 	}
 	else if (c == player)
 	{
-		static sfCircleShape* circle = NULL;
-		static const float radius = 10;
-		static const float scale = 0.5;
-		if (circle == NULL)
-		{
-			circle = sfCircleShape_create();
-			sfCircleShape_setRadius(circle, radius);
-			sfCircleShape_setScale(circle, (sfVector2f){1,scale});
-			sfCircleShape_setFillColor(circle, sfTransparent);
-			sfCircleShape_setOutlineColor(circle, sfWhite);
-			sfCircleShape_setOutlineThickness(circle, 2);
-		}
-		sfCircleShape_setPosition(circle, (sfVector2f){c->o.x-radius, c->o.y-radius*scale-2});
-		sfRenderWindow_drawCircleShape(g->render, circle, NULL);
+		// drawn over the feet, with the other shapes
+		batch_ring(&g->batch, c->o.x, c->o.y-2, 10, 5, 2, sfWhite);
 	}
 
 	static sfSprite* defaultSprite = NULL;
@@ -126,11 +109,7 @@ void draw_character(graphics_t* g, assets_t* a, character_t* player, character_t
 	sfSprite*sprite = c->t == NULL ? defaultSprite : a->sprites[c->t->sprite];
 
 	sfColor color = c->alive ? sfWhite : (sfColor){255,255,255,127};
-	sfSprite_setColor(sprite, color);
-
-	sfSprite_setTextureRect(sprite, rect);
-	sfSprite_setPosition(sprite, pos);
-	sfRenderWindow_drawSprite(g->render, sprite, NULL);
+	batch_sprite(&g->batch, sfSprite_getTexture(sprite), rect, pos, color);
 
 	if (!c->alive)
 		return;
@@ -145,12 +124,12 @@ void draw_character(graphics_t* g, assets_t* a, character_t* player, character_t
 	char draw1 = draw2 || p1 != 1;
 	if (draw1)
 	{
-		draw_progressbar(g, c->o.x - c->o.w/2, c->o.y+6, c->o.w, 5, p1, 0);
+		batch_progressbar(&g->batch, c->o.x - c->o.w/2, c->o.y+6, c->o.w, 5, p1, 0);
 	}
 	if (draw2)
 	{
-		draw_progressbar(g, c->o.x - c->o.w/2, c->o.y+10, c->o.w, 5, p2, -3);
-		draw_progressbar(g, c->o.x - c->o.w/2, c->o.y+14, c->o.w, 5, p3, -4);
+		batch_progressbar(&g->batch, c->o.x - c->o.w/2, c->o.y+10, c->o.w, 5, p2, -3);
+		batch_progressbar(&g->batch, c->o.x - c->o.w/2, c->o.y+14, c->o.w, 5, p3, -4);
 	}
 }
 
@@ -167,8 +146,7 @@ void draw_mine(graphics_t* g, assets_t* a, character_t* player, mine_t* m)
 
 	int t = m->t->id;
 	sfIntRect rect = {32*t, 32*0, 32, 32};
-	sfSprite_setTextureRect(sprite, rect);
-	draw_object(g, a, &m->o, sprite);
+	draw_object(g, a, &m->o, sprite, rect);
 }
 
 void draw_building(graphics_t* g, assets_t* a, character_t* player, building_t* b)
@@ -189,8 +167,7 @@ void draw_building(graphics_t* g, assets_t* a, character_t* player, building_t*
 
 	sfSprite* sprite = a->sprites[b->t->sprite];
 	sfIntRect rect = {0, b->o.h*step, b->o.w, b->o.h};
-	sfSprite_setTextureRect(sprite, rect);
-	draw_object(g, a, &b->o, sprite);
+	draw_object(g, a, &b->o, sprite, rect);
 
 	if (player->hasBuilding == b->o.uuid && player->inBuilding == b->o.uuid && p == 1)
 	{
@@ -211,12 +188,20 @@ void draw_building(graphics_t* g, assets_t* a, character_t* player, building_t*
 			kindOf_material_t* t = &u->materials[id];
 			p = player->inventory.materials[id] / character_maxOfMaterial(player, t);
 		}
-		draw_progressbar(g, b->o.x - b->o.w/2, b->o.y-b->o.h-6, b->o.w, 5, p, -1);
+		batch_progressbar(&g->batch, b->o.x - b->o.w/2, b->o.y-b->o.h-6, b->o.w, 5, p, -1);
 	}
 
 	p = b->life / 20;
 	if (p < 0.99)
-		draw_progressbar(g, b->o.x - b->o.w/2, b->o.y+1, b->o.w, 5, p, 0);
+		batch_progressbar(&g->batch, b->o.x - b->o.w/2, b->o.y+1, b->o.w, 5, p, 0);
+}
+
+static void draw_mesh(graphics_t* g, mesh_t* m, sfRenderStates* states)
+{
+	if (m->buffer != NULL)
+		sfRenderWindow_drawVertexBuffer(g->render, m->buffer, states);
+	else if (m->vertices != NULL)
+		sfRenderWindow_drawPrimitives(g->render, m->vertices, m->n_vertices, sfQuads, states);
 }
 
 void draw_chunkLands(graphics_t* g, assets_t* a, character_t* player, chunk_t* c, int step)
@@ -227,14 +212,195 @@ void draw_chunkLands(graphics_t* g, assets_t* a, character_t* player, chunk_t* c
 	if (states.texture == NULL)
 		states.texture = assets_loadImage(a, "data/lands.png");
 
-	sfVertexArray* array = c->array;
-	if (step != c->water_step)
+	// the water goes back and forth between its frames
+	int frame = step == 3 ? 1 : step;
+	draw_mesh(g, &c->terrain, &states);
+	draw_mesh(g, &c->water[frame], &states);
+}
+
+// below this size of tiles on screen, in pixels, each chunk is
+// drawn as one quad from a texture of its lands, baked once
+#define FAR_TILE   4
+#define FAR_MIN    16  // sizes of the textures, in pixels
+#define FAR_MAX    256
+#define FAR_BAKES  8   // textures baked per frame, at most
+#define FAR_MARKER 6   // size of the markers, in pixels
+
+// color of each land type, for chunks not baked yet
+static const sfColor far_tones[16] =
+{
+	[ 0] = {120, 200,  80, 255},
+	[ 1] = { 60, 140,  60, 255},
+	[ 2] = {200, 200, 120, 255},
+	[ 3] = {150, 120,  80, 255},
+	[ 4] = {120, 120, 120, 255},
+	[10] = { 40,  80, 200, 255},
+};
+
+static void bake_mesh(sfRenderTexture* r, mesh_t* m, sfRenderStates* states)
+{
+	if (m->buffer != NULL)
+		sfRenderTexture_drawVertexBuffer(r, m->buffer, states);
+	else if (m->vertices != NULL)
+		sfRenderTexture_drawPrimitives(r, m->vertices, m->n_vertices, sfQuads, states);
+}
+
+// all chunks are rendered through the same target, then copied to a
+// texture of their own
+static void draw_bake(assets_t* a, world_t* w, chunk_t* c, unsigned int size)
+{
+	static sfRenderTexture* target = NULL;
+	static unsigned int target_size = 0;
+	if (target == NULL || target_size != size)
+	{
+		if (target != NULL)
+			sfRenderTexture_destroy(target);
+		target = sfRenderTexture_create(size, size, sfFalse);
+		target_size = target == NULL ? 0 : size;
+		if (target == NULL)
+			return;
+	}
+
+	if (c->baked == NULL || c->baked_size != size)
+	{
+		chunk_freeBaked(c);
+		c->baked = sfTexture_create(size, size);
+		if (c->baked == NULL)
+			return;
+		c->baked_size = size;
+		sfTexture_setSmooth(c->baked, sfTrue);
+	}
+
+	// the vertices of a chunk not in view are only built for the time of the baking
+	world_touchChunk(w, c);
+	chunk_tone(c);
+	char meshed = c->meshed;
+	if (meshed)
+		chunk_patch(c);
+	else
+		chunk_update(c);
+
+	float cw = TILE_SIZE * c->cols;
+	float ch = TILE_SIZE * c->rows;
+	sfView* view = sfView_createFromRect((sfFloatRect){c->o.x - cw/2, c->o.y - ch, cw, ch});
+	sfRenderStates states = {sfBlendAlpha, {{1,0,0,0,1,0,0,0,1}}, assets_loadImage(a, "data/lands.png"), NULL};
+	sfRenderTexture_setView(target, view);
+	sfRenderTexture_clear(target, sfBlack);
+	bake_mesh(target, &c->terrain, &states);
+	bake_mesh(target, &c->water[0], &states);
+	sfRenderTexture_display(target);
+	sfTexture_updateFromRenderTexture(c->baked, target, 0, 0);
+	sfView_destroy(view);
+
+	if (!meshed)
+		chunk_freeMesh(c);
+	c->stale = 0;
+	world_keepBaked(w, c);
+}
+
+static void far_quad(sfVertexArray* v, float x, float y, float w, float h, sfColor color)
+{
+	sfVertexArray_append(v, (sfVertex){{x,   y  }, color, {0,0}});
+	sfVertexArray_append(v, (sfVertex){{x+w, y  }, color, {0,0}});
+	sfVertexArray_append(v, (sfVertex){{x+w, y+h}, color, {0,0}});
+	sfVertexArray_append(v, (sfVertex){{x,   y+h}, color, {0,0}});
+}
+
+// lands from the baked textures, and a marker for the mines, the
+// buildings and the characters of each chunk rather than their sprites
+static void draw_far(graphics_t* g, assets_t* a, character_t* player, world_t* w, int i0, int i1, int j0, int j1, float scale)
+{
+	if (i1 < i0 || j1 < j0)
+		return;
+
+	static sfVertexArray* flat = NULL;
+	static sfVertexArray* markers = NULL;
+	if (flat == NULL)
 	{
-		c->water_step = step;
-		chunk_updwtr(c);
+		flat = sfVertexArray_create();
+		markers = sfVertexArray_create();
+		sfVertexArray_setPrimitiveType(flat, sfQuads);
+		sfVertexArray_setPrimitiveType(markers, sfQuads);
 	}
+	sfVertexArray_clear(flat);
+	sfVertexArray_clear(markers);
+
+	// smallest power of two covering the chunk on screen
+	float cw = TILE_SIZE * w->chunks[0].cols;
+	float ch = TILE_SIZE * w->chunks[0].rows;
+	unsigned int size = FAR_MIN;
+	while (size < cw*scale && size < FAR_MAX)
+		size *= 2;
+
+	size_t n_visible = (i1-i0+1) * (j1-j0+1);
+	w->max_baked = 2*n_visible < WORLD_BAKED ? WORLD_BAKED : 2*n_visible;
+
+	// characters, by visible chunk
+	char* crowded = CALLOC(char, n_visible);
+	memset(crowded, 0, n_visible);
+	pool_t* p = &w->objects;
+	for (size_t k = 0; k < p->n_objects; k++)
+	{
+		object_t* o = p->objects[k];
+		if (o->t != O_CHARACTER || o == &player->o)
+			continue;
+		int i = floor((o->y + w->o.h/2) / ch);
+		int j = floor((o->x + w->o.w/2) / cw);
+		if (i0 <= i && i <= i1 && j0 <= j && j <= j1)
+			crowded[(i-i0)*(j1-j0+1) + (j-j0)] = 1;
+	}
+
+	float m = FAR_MARKER / scale;
+	int bakes = 0;
+	sfRenderStates states = {sfBlendAlpha, {{1,0,0,0,1,0,0,0,1}}, NULL, NULL};
+	for (int i = i0; i <= i1; i++)
+		for (int j = j0; j <= j1; j++)
+		{
+			chunk_t* c = CHUNK(w, i, j);
+			float x = c->o.x - cw/2;
+			float y = c->o.y - ch;
+
+			// a texture of another size is still drawn until it is replaced
+			if ((c->baked == NULL || c->baked_size != size || c->stale) && bakes < FAR_BAKES)
+			{
+				draw_bake(a, w, c, size);
+				bakes++;
+			}
+
+			if (c->baked != NULL)
+			{
+				world_keepBaked(w, c);
+				float t = c->baked_size;
+				sfVertex v[4] =
+				{
+					{{x,    y   }, sfWhite, {0,0}},
+					{{x+cw, y   }, sfWhite, {t,0}},
+					{{x+cw, y+ch}, sfWhite, {t,t}},
+					{{x,    y+ch}, sfWhite, {0,t}},
+				};
+				states.texture = c->baked;
+				sfRenderWindow_drawPrimitives(g->render, v, 4, sfQuads, &states);
+			}
+			else
+				far_quad(flat, x, y, cw, ch, far_tones[chunk_tone(c)]);
+
+			float mx = c->o.x - m/2;
+			float my = c->o.y - ch/2 - m/2;
+			if (c->n_mines != 0)
+				far_quad(markers, mx - 1.5*m, my, m, m, (sfColor){255, 210,   0, 255});
+			if (c->n_buildings != 0)
+				far_quad(markers, mx,         my, m, m, (sfColor){255, 255, 255, 255});
+			if (crowded[(i-i0)*(j1-j0+1) + (j-j0)])
+				far_quad(markers, mx + 1.5*m, my, m, m, (sfColor){220,  40,  40, 255});
+		}
+	free(crowded);
+
+	// the player stays in sight
+	if (player != NULL)
+		far_quad(markers, player->o.x - m, player->o.y - player->o.h/2 - m, 2*m, 2*m, (sfColor){40, 220, 220, 255});
 
-	sfRenderWindow_drawVertexArray(g->render, array, &states);
+	sfRenderWindow_drawVertexArray(g->render, flat, NULL);
+	sfRenderWindow_drawVertexArray(g->render, markers, NULL);
 }
 
 void draw_world(graphics_t* g, assets_t* a, character_t* player, world_t* w, int step)
@@ -242,25 +408,70 @@ void draw_world(graphics_t* g, assets_t* a, character_t* player, world_t* w, int
 	sfVector2f x = sfView_getCenter(g->world_view);
 	sfVector2f s = sfView_getSize(g->world_view);
 
+	// size of a tile on screen
+	sfVector2u ws = sfRenderWindow_getSize(g->render);
+	float scale = ws.x / s.x;
+
 	// quickfix: force chunks with jutting potential mines
 	s.x += 64;
 	s.y += 64;
 
 	object_t view = {0, 0, O_NONE, x.x, x.y+s.y/2, s.x, s.y};
 
-	// draw chunks (fist lands, then mines, then buildings)
-	for (size_t i = 0; i < w->n_chunks; i++)
+	// range of visible chunks
+	float ch = TILE_SIZE * w->chunks[0].rows;
+	float cw = TILE_SIZE * w->chunks[0].cols;
+	int i0 = floor((x.y - s.y/2 + w->o.h/2) / ch);
+	int i1 = floor((x.y + s.y/2 + w->o.h/2) / ch);
+	int j0 = floor((x.x - s.x/2 + w->o.w/2) / cw);
+	int j1 = floor((x.x + s.x/2 + w->o.w/2) / cw);
+	if (i0 < 0) i0 = 0;
+	if (j0 < 0) j0 = 0;
+	if (i1 >= w->chunk_rows) i1 = w->chunk_rows-1;
+	if (j1 >= w->chunk_cols) j1 = w->chunk_cols-1;
+
+	if (TILE_SIZE * scale < FAR_TILE)
 	{
-		chunk_t* c = &w->chunks[i];
-		if (object_overlaps(&c->o, &view))
+		draw_far(g, a, player, w, i0, i1, j0, j1, scale);
+		return;
+	}
+
+	// keep the vertices of the chunks around the view too
+	size_t near = (i1-i0+3) * (j1-j0+3);
+	w->max_meshes = 2*near < WORLD_MESHES ? WORLD_MESHES : 2*near;
+
+	// draw chunks (fist lands, then mines, then buildings); sprites are
+	// batched by texture, and flushed between layers to keep them in order
+	for (int i = i0; i <= i1; i++)
+		for (int j = j0; j <= j1; j++)
 		{
+			chunk_t* c = CHUNK(w, i, j);
+			world_showChunk(w, c);
 			draw_chunkLands(g, a, player, c, step);
 			for (ssize_t i = c->n_mines-1; i >= 0; i--)
 				draw_mine(g, a, player, c->mines[i]);
+		}
+	batch_flush(&g->batch, g->render);
+
+	for (int i = i0; i <= i1; i++)
+		for (int j = j0; j <= j1; j++)
+		{
+			chunk_t* c = CHUNK(w, i, j);
 			for (ssize_t i = c->n_buildings-1; i >= 0; i--)
 				draw_building(g, a, player, c->buildings[i]);
 		}
-	}
+	batch_flush(&g->batch, g->render);
+
+	// prepare the ring of chunks around, before they are in view
+	for (int i = i0-1; i <= i1+1; i++)
+		for (int j = j0-1; j <= j1+1; j++)
+		{
+			if (i < 0 || i >= w->chunk_rows || j < 0 || j >= w->chunk_cols)
+				continue;
+			if (i0 <= i && i <= i1 && j0 <= j && j <= j1)
+				continue;
+			world_showChunk(w, CHUNK(w, i, j));
+		}
 
 	pool_t* p = &w->objects;
 	for (size_t i = 0; i < p->n_objects; i++)
@@ -269,6 +480,7 @@ void draw_world(graphics_t* g, assets_t* a, character_t* player, world_t* w, int
 		if (o->t == O_CHARACTER && object_overlaps(o, &view))
 			draw_character(g, a, player, (character_t*) o);
 	}
+	batch_flush(&g->batch, g->render);
 
 	for (size_t i = 0; i < p->n_objects; i++)
 	{
@@ -276,7 +488,9 @@ void draw_world(graphics_t* g, assets_t* a, character_t* player, world_t* w, int
 		if (o->t == O_PROJECTILE && object_overlaps(o, &view))
 			draw_projectile(g, a, player, (projectile_t*) o);
 	}
+	batch_flush(&g->batch, g->render);
 
 	for (ssize_t i = w->events.n-1; i >= 0; i--)
 		draw_event(g, a, player, &w->events.d[i]);
+	batch_flush(&g->batch, g->render);
 }
@@ -22,6 +22,7 @@
 #include "world.h"
 #include "../graphics.h"
 
+// entities are queued in the batch of g, which draw_world flushes
 void draw_event     (graphics_t* g, assets_t* a, character_t* player, event_t* e);
 void draw_projectile(graphics_t* g, assets_t* a, character_t* player, projectile_t* p);
 void draw_character (graphics_t* g, assets_t* a, character_t* player, character_t* c);
@@ -81,7 +81,7 @@ void load_inventory(cfg_t* cfg, inventory_t* inv, universe_t* u)
 }
 void load_ai_data(cfg_t* cfg, ai_data_t* d)
 {
-	d->step    = cfg_get_int(cfg, "step");
+	d->pc      = cfg_get_int(cfg, "pc");
 	d->collect = cfg_get_int(cfg, "collect");
 	d->sell    = cfg_get_int(cfg, "sell");
 }
@@ -144,9 +144,13 @@ void load_world(cfg_t* cfg, world_t* w)
 	universe_t* u = w->universe;
 
 	w->seed = cfg_get_int(cfg, "seed");
+	w->generator = cfg_get_int(cfg, "generator");
+	// mines are generated again, as they were when saved
+	w->lazy = cfg_get_int(cfg, "stream");
 	w->rows = cfg_get_int(cfg, "rows");
 	w->cols = cfg_get_int(cfg, "cols");
-	world_genmap(w, w->seed);
+	if (!world_genmap(w, w->seed))
+		return;
 
 	cfg_t* characters = cfg_get_group(cfg, "characters");
 	if (characters != NULL)
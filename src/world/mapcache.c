@@ -0,0 +1,218 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "mapcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../mem.h"
+#include "../file.h"
+
+static const char magic[4] = {'V','D','M','C'};
+
+typedef struct
+{
+	int   type;
+	float x;
+	float y;
+} cmine_t;
+
+static void cache_name(world_t* w, char* name, size_t n)
+{
+	snprintf(name, n, MAPCACHE_DIR "map_%08x_%ix%i_%i.cache", w->seed, w->rows, w->cols, w->generator);
+}
+
+// remove the least recently written caches, to leave room for n more
+static void prune(size_t n)
+{
+	while (1)
+	{
+		size_t count = 0;
+		time_t oldest_time = 0;
+		char oldest[1024];
+		FOREACH_FILE(MAPCACHE_DIR,
+			size_t l = strlen(path);
+			if (l > 6 && strcmp(path + l - 6, ".cache") == 0)
+			{
+				time_t t = mtime(path);
+				if (count == 0 || t < oldest_time)
+				{
+					oldest_time = t;
+					strcpy(oldest, path);
+				}
+				count++;
+			}
+		);
+		if (count + n <= MAPCACHE_MAX || remove(oldest) != 0)
+			return;
+	}
+}
+
+// tiles are stored row by row, each row spanning several chunks
+static char cache_lands(world_t* w, FILE* f, char save)
+{
+	int ch = w->chunks[0].rows;
+	int cw = w->chunks[0].cols;
+	for (int i = 0; i < w->rows; i++)
+	for (int cj = 0; cj < w->chunk_cols; cj++)
+	{
+		short* row = &LAND(CHUNK(w, i/ch, cj), i%ch, 0);
+		size_t n = save ? fwrite(row, sizeof(short), cw, f) : fread(row, sizeof(short), cw, f);
+		if (n != (size_t) cw)
+			return 0;
+	}
+	return 1;
+}
+
+// remove the mines added since, so that generation gives them the same uuids
+static void drop_mines(world_t* w, size_t n_objects, size_t n_indices)
+{
+	pool_t* p = &w->objects;
+	while (p->n_objects > n_objects)
+	{
+		mine_t* m = (mine_t*) p->objects[p->n_objects-1];
+		object_t o = m->o;
+		chunk_t* c[4] =
+		{
+			world_chunkXY(w, o.x-o.w/2, o.y-o.h),
+			world_chunkXY(w, o.x-o.w/2, o.y    ),
+			world_chunkXY(w, o.x+o.w/2, o.y-o.h),
+			world_chunkXY(w, o.x+o.w/2, o.y    ),
+		};
+		for (int k = 0; k < 4; k++)
+			if (c[k] != NULL && c[k]->n_mines != 0 && c[k]->mines[c[k]->n_mines-1] == m)
+				c[k]->n_mines--;
+		mine_exit(m);
+		pool_pop(p);
+		free(m);
+	}
+	p->n_indices = n_indices;
+}
+
+char mapcache_load(world_t* w)
+{
+	char name[128];
+	cache_name(w, name, sizeof(name));
+	FILE* f = fopen(name, "rb");
+	if (f == NULL)
+		return 0;
+
+	// check that the cache matches this world
+	char m[4];
+	int header[5];
+	uint32_t n_mines;
+	if (fread(m, 1, 4, f) != 4 || memcmp(m, magic, 4) != 0 ||
+	    fread(header, sizeof(int), 5, f) != 5 ||
+	    header[0] != MAPCACHE_VERSION || (unsigned int) header[1] != w->seed ||
+	    header[2] != w->rows || header[3] != w->cols || header[4] != w->generator ||
+	    fread(&n_mines, sizeof(uint32_t), 1, f) != 1 ||
+	    n_mines > (uint32_t) (w->rows * w->cols))
+	{
+		fclose(f);
+		return 0;
+	}
+
+	// a partial read leaves tiles that generation will overwrite
+	cmine_t* mines = CALLOC(cmine_t, n_mines);
+	if (!cache_lands(w, f, 0) || fread(mines, sizeof(cmine_t), n_mines, f) != n_mines)
+	{
+		fprintf(stderr, "Ignoring truncated map cache '%s'\n", name);
+		free(mines);
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+
+	universe_t* u = w->universe;
+	pool_t* p = &w->objects;
+	size_t n_objects = p->n_objects;
+	size_t n_indices = p->n_indices;
+	for (uint32_t i = 0; i < n_mines; i++)
+	{
+		cmine_t* c = &mines[i];
+		if (c->type < 0 || (size_t) c->type >= u->n_mines ||
+		    world_addMine(w, -1, c->x, c->y, &u->mines[c->type]) == NULL)
+		{
+			fprintf(stderr, "Ignoring map cache '%s' with an invalid mine\n", name);
+			drop_mines(w, n_objects, n_indices);
+			free(mines);
+			return 0;
+		}
+	}
+	free(mines);
+
+	if (w->settings->verbosity >= 1)
+		fprintf(stderr, "Loaded map from '%s'\n", name);
+	return 1;
+}
+
+void mapcache_save(world_t* w)
+{
+	universe_t* u = w->universe;
+
+	// mines are listed in creation order, so that they get the same uuids
+	pool_t* p = &w->objects;
+	uint32_t n_mines = 0;
+	cmine_t* mines = CALLOC(cmine_t, p->n_objects);
+	for (size_t i = 0; i < p->n_objects; i++)
+	{
+		object_t* o = p->objects[i];
+		if (o->t != O_MINE)
+			continue;
+		mine_t* m = (mine_t*) o;
+		mines[n_mines++] = (cmine_t){m->t - u->mines, o->x, o->y};
+	}
+
+	// the map cache is only an optimization, it is given up quietly
+	char name[128];
+	cache_name(w, name, sizeof(name));
+	FILE* f = NULL;
+	if (makedir(MAPCACHE_DIR))
+	{
+		prune(1);
+		f = fopen(name, "wb");
+	}
+	if (f == NULL)
+	{
+		if (w->settings->verbosity >= 2)
+			fprintf(stderr, "Could not write map cache '%s'\n", name);
+		free(mines);
+		return;
+	}
+
+	int header[5] = {MAPCACHE_VERSION, w->seed, w->rows, w->cols, w->generator};
+	char ok = fwrite(magic, 1, 4, f) == 4 &&
+	          fwrite(header, sizeof(int), 5, f) == 5 &&
+	          fwrite(&n_mines, sizeof(uint32_t), 1, f) == 1 &&
+	          cache_lands(w, f, 1) &&
+	          fwrite(mines, sizeof(cmine_t), n_mines, f) == n_mines;
+	fclose(f);
+	free(mines);
+
+	// do not leave a broken cache behind
+	if (!ok)
+	{
+		fprintf(stderr, "Could not write map cache '%s'\n", name);
+		remove(name);
+	}
+	else if (w->settings->verbosity >= 3)
+		fprintf(stderr, "Saved map to '%s'\n", name);
+}
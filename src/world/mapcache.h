@@ -0,0 +1,35 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef W_MAPCACHE_H
+#define W_MAPCACHE_H
+
+#include "world.h"
+
+// bump whenever generation changes the map of a given seed
+#define MAPCACHE_VERSION 2
+
+// generated tiles and mines, stored in a file named after the seed, the
+// size and the generator; mapcache_load() returns 0 when there is none
+#define MAPCACHE_DIR "cache/"
+#define MAPCACHE_MAX 16 // files kept, the least recently written go first
+
+char mapcache_load(world_t* w);
+void mapcache_save(world_t* w);
+
+#endif
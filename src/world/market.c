@@ -0,0 +1,182 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "market.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../mem.h"
+#include "world.h"
+
+void market_init(market_t* m, world_t* w)
+{
+	universe_t* u = w->universe;
+
+	m->w = w;
+
+	m->rows = (w->chunk_rows + MARKET_BUCKET-1) / MARKET_BUCKET;
+	m->cols = (w->chunk_cols + MARKET_BUCKET-1) / MARKET_BUCKET;
+	m->size = MARKET_BUCKET * 64 * TILE_SIZE;
+	if (w->n_chunks != 0)
+		m->size = MARKET_BUCKET * w->chunks[0].rows * TILE_SIZE;
+
+	m->n_keys = u->n_materials + u->n_items;
+	m->counts = CALLOC(size_t, m->n_keys);
+	memset(m->counts, 0, sizeof(size_t) * m->n_keys);
+
+	size_t n = m->n_keys * m->rows * m->cols;
+	m->buckets = CALLOC(mkBucket_t, n);
+	memset(m->buckets, 0, sizeof(mkBucket_t) * n);
+}
+
+void market_exit(market_t* m)
+{
+	size_t n = m->n_keys * m->rows * m->cols;
+	for (size_t i = 0; i < n; i++)
+		free(m->buckets[i].d);
+	free(m->buckets);
+	free(m->counts);
+}
+
+static size_t key(market_t* m, char is_item, int id)
+{
+	return is_item ? m->w->universe->n_materials + id : (size_t) id;
+}
+
+static mkBucket_t* bucket(market_t* m, size_t k, int i, int j)
+{
+	return &m->buckets[(k*m->rows + i)*m->cols + j];
+}
+
+static void locate(market_t* m, float x, float y, int* i, int* j)
+{
+	world_t* w = m->w;
+	*i = (y + w->o.h/2) / m->size;
+	*j = (x + w->o.w/2) / m->size;
+	if (*i < 0) *i = 0;
+	if (*j < 0) *j = 0;
+	if (*i >= m->rows) *i = m->rows-1;
+	if (*j >= m->cols) *j = m->cols-1;
+}
+
+// lists or unlists a building for a component
+static void set(market_t* m, building_t* b, char is_item, int id, char listed)
+{
+	int i, j;
+	locate(m, b->o.x, b->o.y, &i, &j);
+	size_t k = key(m, is_item, id);
+	mkBucket_t* l = bucket(m, k, i, j);
+
+	size_t idx = 0;
+	while (idx < l->n && l->d[idx] != b)
+		idx++;
+
+	if (listed && idx == l->n)
+	{
+		if (l->n == l->a)
+		{
+			l->a = l->a == 0 ? 1 : 2*l->a;
+			l->d = CREALLOC(l->d, building_t*, l->a);
+		}
+		l->d[l->n++] = b;
+		m->counts[k]++;
+	}
+	else if (!listed && idx != l->n)
+	{
+		l->d[idx] = l->d[--l->n];
+		m->counts[k]--;
+	}
+}
+
+static void set_all(market_t* m, building_t* b, transform_t* tr, char keep)
+{
+	for (int i = 0; i < tr->n_res; i++)
+	{
+		component_t* c = &tr->res[i];
+		char listed = keep && inventory_get(&b->inventory, c->is_item, c->id) > 0;
+		set(m, b, c->is_item, c->id, listed);
+	}
+}
+
+void market_update(market_t* m, building_t* b)
+{
+	kindOf_building_t* t = b->t;
+	set_all(m, b, &t->make, 1);
+	for (size_t i = 0; i < t->n_items; i++)
+		set_all(m, b, &t->items[i], 1);
+}
+
+void market_del(market_t* m, building_t* b)
+{
+	kindOf_building_t* t = b->t;
+	set_all(m, b, &t->make, 0);
+	for (size_t i = 0; i < t->n_items; i++)
+		set_all(m, b, &t->items[i], 0);
+}
+
+building_t* market_find(market_t* m, float x, float y, char is_item, int id, float amount)
+{
+	size_t k = key(m, is_item, id);
+	if (m->counts[k] == 0)
+		return NULL;
+
+	int i, j;
+	locate(m, x, y, &i, &j);
+
+	building_t* ret = NULL;
+	float min_d = -1;
+	int max_r = m->rows > m->cols ? m->rows : m->cols;
+	for (int radius = 0; radius < max_r; radius++)
+	{
+		// only the border of the square of the given radius
+		for (int di = -radius; di <= radius; di++)
+		{
+			int ti = i + di;
+			if (!(0 <= ti && ti < m->rows))
+				continue;
+
+			int step = di == -radius || di == radius ? 1 : 2*radius;
+			for (int dj = -radius; dj <= radius; dj += step)
+			{
+				int tj = j + dj;
+				if (!(0 <= tj && tj < m->cols))
+					continue;
+
+				mkBucket_t* l = bucket(m, k, ti, tj);
+				for (size_t n = 0; n < l->n; n++)
+				{
+					building_t* b = l->d[n];
+					if (inventory_get(&b->inventory, is_item, id) < amount)
+						continue;
+					float d = object_distance(&b->o, x, y);
+					if (d < min_d || min_d < 0)
+					{
+						ret = b;
+						min_d = d;
+					}
+				}
+			}
+		}
+
+		// everything farther is at least 'radius' buckets away
+		if (ret != NULL && min_d <= radius*m->size)
+			break;
+	}
+	return ret;
+}
@@ -0,0 +1,66 @@
+/*\
+ *  Role playing, management and strategy game
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef W_MARKET_H
+#define W_MARKET_H
+
+typedef struct mkBucket mkBucket_t;
+typedef struct market   market_t;
+
+#include <sys/types.h>
+
+struct building;
+struct world;
+
+// side of a bucket, in chunks
+#define MARKET_BUCKET 4
+
+// buildings currently selling one kind of component in one area
+struct mkBucket
+{
+	size_t n;
+	size_t a;
+	struct building** d;
+};
+
+// index of the buildings with stock; there is one bucket
+// list per component (materials then items) and per area
+struct market
+{
+	struct world* w;
+
+	int rows;
+	int cols;
+	float size; // side of a bucket in world units
+
+	size_t n_keys;
+	size_t* counts; // number of sellers for each component
+	mkBucket_t* buckets;
+};
+
+void market_init(market_t* m, struct world* w);
+void market_exit(market_t* m);
+
+// synchronize the entries of a building with its inventory
+void market_update(market_t* m, struct building* b);
+void market_del   (market_t* m, struct building* b);
+
+// nearest building with at least 'amount' of the component in stock
+struct building* market_find(market_t* m, float x, float y, char is_item, int id, float amount);
+
+#endif
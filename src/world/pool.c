@@ -99,6 +99,17 @@ void pool_upd(pool_t* p)
 	}
 }
 
+void pool_reserve(pool_t* p, size_t n)
+{
+	if (n <= p->n_indices)
+		return;
+
+	p->indices = CREALLOC(p->indices, ssize_t, n);
+	for (size_t i = p->n_indices; i < n; i++)
+		p->indices[i] = -1;
+	p->n_indices = n;
+}
+
 void pool_push(pool_t* p, object_t* o)
 {
 	if (p->n_objects == p->a_objects)
@@ -41,6 +41,9 @@ object_t* pool_get(pool_t* p, uuid_t uuid);
 void      pool_del(pool_t* p, object_t* a);
 void      pool_upd(pool_t* p);
 
+// uuids below n are then only given on request
+void      pool_reserve(pool_t* p, size_t n);
+
 // internal
 void pool_push(pool_t* p, object_t* o);
 void pool_pop (pool_t* p);
@@ -62,7 +62,7 @@ void save_inventory(cfg_t* cfg, inventory_t* inv, universe_t* u)
 }
 void save_ai_data(cfg_t* cfg, ai_data_t* d)
 {
-	cfg_put_int(cfg, "step",    d->step);
+	cfg_put_int(cfg, "pc",      d->pc);
 	cfg_put_int(cfg, "collect", d->collect);
 	cfg_put_int(cfg, "sell",    d->sell);
 }
@@ -130,6 +130,8 @@ void save_building(cfg_t* cfg, building_t* b)
 void save_world(cfg_t* cfg, world_t* w)
 {
 	cfg_put_int(cfg, "seed", w->seed);
+	cfg_put_int(cfg, "generator", w->generator);
+	cfg_put_int(cfg, "stream", w->lazy);
 	cfg_put_int(cfg, "rows", w->rows);
 	cfg_put_int(cfg, "cols", w->cols);
 
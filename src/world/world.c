@@ -20,11 +20,14 @@
 
 #include <stdlib.h>
 
+#include "chunkgen.h"
+
 void world_init(world_t* w, game_t* g)
 {
 	w->settings = g->s;
 	w->universe = g->u;
 
+	w->generator = g->s->generator;
 	w->cols = 0;
 	w->rows = 0;
 	w->chunk_cols = 0;
@@ -32,7 +35,19 @@ void world_init(world_t* w, game_t* g)
 	w->n_chunks = 0;
 	w->chunks = NULL;
 
+	w->lazy = g->s->stream;
+	w->swap = NULL;
+	for (int k = 0; k < LRU_LISTS; k++)
+		w->lru[k] = (lru_list_t){NULL, NULL, 0};
+	w->max_meshes = WORLD_MESHES;
+	w->max_baked  = WORLD_BAKED;
+
 	pool_init(&w->objects);
+	w->tick = 0;
+	w->version = 0;
+
+	aisched_init(&w->sched, g->s->ai_budget);
+	w->progress = NULL;
 }
 
 void world_exit(world_t* w)
@@ -55,9 +70,14 @@ void world_exit(world_t* w)
 	}
 	pool_exit(p);
 
+	market_exit(&w->market);
+	aisched_exit(&w->sched);
+
 	for (size_t i = 0; i < w->n_chunks; i++)
 		chunk_exit(&w->chunks[i]);
 	free(w->chunks);
+	if (w->swap != NULL)
+		fclose(w->swap);
 
 	evtList_exit(&w->events);
 }
@@ -88,9 +108,9 @@ short world_getLandXY(world_t* w, float x, float y)
 
 void world_setLandXY(world_t* w, float x, float y, short l)
 {
-	short* land = world_landXY(w, x, y);
-	if (land != NULL)
-		*land = l;
+	int i = (y + w->o.h/2)/TILE_SIZE;
+	int j = (x + w->o.w/2)/TILE_SIZE;
+	world_setLandIJ(w, i, j, l);
 }
 
 short* world_landIJ(world_t* w, int i, int j)
@@ -100,9 +120,135 @@ short* world_landIJ(world_t* w, int i, int j)
 	int ch = w->chunks[0].rows;
 	int cw = w->chunks[0].cols;
 	chunk_t* c = CHUNK(w, i/ch, j/cw);
+	if (w->lazy)
+		world_touchChunk(w, c);
 	return &LAND(c, i%ch, j%cw);
 }
 
+static void lru_unlink(world_t* w, chunk_t* c, lru_kind_t k)
+{
+	lru_list_t* l = &w->lru[k];
+	lru_link_t* n = &c->lru[k];
+	if (n->prev != NULL)
+		n->prev->lru[k].next = n->next;
+	else
+		l->first = n->next;
+	if (n->next != NULL)
+		n->next->lru[k].prev = n->prev;
+	else
+		l->last = n->prev;
+	n->prev = NULL;
+	n->next = NULL;
+	l->n--;
+}
+static void lru_push(world_t* w, chunk_t* c, lru_kind_t k)
+{
+	lru_list_t* l = &w->lru[k];
+	lru_link_t* n = &c->lru[k];
+	n->prev = NULL;
+	n->next = l->first;
+	if (l->first != NULL)
+		l->first->lru[k].prev = c;
+	else
+		l->last = c;
+	l->first = c;
+	l->n++;
+}
+// tiles are only written again when they were changed since
+static void swap_out(world_t* w, chunk_t* c)
+{
+	if (!c->swapped)
+	{
+		if (w->swap == NULL)
+			w->swap = tmpfile();
+		size_t n = c->rows * c->cols;
+		long offset = (long) (c - w->chunks) * n * sizeof(short);
+		if (w->swap != NULL && fseek(w->swap, offset, SEEK_SET) == 0 &&
+		    fwrite(c->lands, sizeof(short), n, w->swap) == n)
+			c->swapped = 1;
+	}
+	chunk_unload(c);
+}
+static char swap_in(world_t* w, chunk_t* c)
+{
+	size_t n = c->rows * c->cols;
+	long offset = (long) (c - w->chunks) * n * sizeof(short);
+	return fseek(w->swap, offset, SEEK_SET) == 0 &&
+	       fread(c->lands, sizeof(short), n, w->swap) == n;
+}
+void world_touchChunk(world_t* w, chunk_t* c)
+{
+	if (!w->lazy)
+		return;
+
+	if (c->lands != NULL)
+	{
+		if (w->lru[LRU_TILES].first != c)
+		{
+			lru_unlink(w, c, LRU_TILES);
+			lru_push(w, c, LRU_TILES);
+		}
+		return;
+	}
+
+	if (w->lru[LRU_TILES].n >= WORLD_RESIDENT)
+	{
+		chunk_t* old = w->lru[LRU_TILES].last;
+		lru_unlink(w, old, LRU_TILES);
+		swap_out(w, old);
+	}
+
+	chunk_load(c);
+	lru_push(w, c, LRU_TILES);
+
+	// a failed read is not fatal, since generation is deterministic
+	if (!c->swapped || !swap_in(w, c))
+		world_genChunk(w, c);
+}
+
+void world_showChunk(world_t* w, chunk_t* c)
+{
+	world_touchChunk(w, c);
+
+	if (c->meshed)
+	{
+		if (w->lru[LRU_MESHES].first != c)
+		{
+			lru_unlink(w, c, LRU_MESHES);
+			lru_push(w, c, LRU_MESHES);
+		}
+		chunk_patch(c);
+		return;
+	}
+
+	while (w->lru[LRU_MESHES].n >= w->max_meshes)
+	{
+		chunk_t* old = w->lru[LRU_MESHES].last;
+		lru_unlink(w, old, LRU_MESHES);
+		chunk_freeMesh(old);
+	}
+
+	chunk_update(c);
+	lru_push(w, c, LRU_MESHES);
+}
+
+void world_keepBaked(world_t* w, chunk_t* c)
+{
+	lru_list_t* l = &w->lru[LRU_BAKED];
+	if (l->first == c)
+		return;
+	if (c->lru[LRU_BAKED].prev != NULL)
+		lru_unlink(w, c, LRU_BAKED);
+	lru_push(w, c, LRU_BAKED);
+
+	while (l->n > w->max_baked)
+	{
+		chunk_t* old = l->last;
+		lru_unlink(w, old, LRU_BAKED);
+		chunk_freeBaked(old);
+	}
+}
+
 short world_getLandIJ(world_t* w, int i, int j)
 {
 	short* land = world_landIJ(w, i, j);
@@ -112,13 +258,55 @@ short world_getLandIJ(world_t* w, int i, int j)
 void world_setLandIJ(world_t* w, int i, int j, short l)
 {
 	short* land = world_landIJ(w, i, j);
-	if (land != NULL)
-		*land = l;
+	if (land == NULL || *land == l)
+		return;
+	*land = l;
+
+	int ch = w->chunks[0].rows;
+	int cw = w->chunks[0].cols;
+	chunk_t* c = CHUNK(w, i/ch, j/cw);
+	chunk_setDirty(c, i%ch, j%cw);
+	c->swapped = 0;
+}
+
+// land type, the map borders being repeated
+static short typeIJ(world_t* w, int i, int j)
+{
+	i = i < 0 ? 0 : i >= w->rows ? w->rows-1 : i;
+	j = j < 0 ? 0 : j >= w->cols ? w->cols-1 : j;
+	return world_getLandIJ(w, i, j) / 16;
+}
+
+void world_setTypeIJ(world_t* w, int i, int j, short t)
+{
+	if (!(0 <= i && i < w->rows && 0 <= j && j < w->cols))
+		return;
+	world_setLandIJ(w, i, j, 16*t);
+
+	// the tile and its 4-neighbours pick their borders again
+	static const int di[5] = {0,-1,0,1,0};
+	static const int dj[5] = {0,0,1,0,-1};
+	for (int k = 0; k < 5; k++)
+	{
+		int a = i + di[k];
+		int b = j + dj[k];
+		if (!(0 <= a && a < w->rows && 0 <= b && b < w->cols))
+			continue;
+		short type[9];
+		for (int u = 0; u < 3; u++)
+			for (int v = 0; v < 3; v++)
+				type[u*3+v] = typeIJ(w, a+u-1, b+v-1);
+		short l;
+		chunkgen_borders(&l, &type[4], 3, 1);
+		world_setLandIJ(w, a, b, l);
+	}
 }
 
 void world_doRound(world_t* w, float duration)
 {
+	w->tick++;
 	evtList_doRound(&w->events, duration);
+	aisched_doRound(&w->sched, w, duration);
 
 	pool_t* p = &w->objects;
 	for (size_t i = 0; i < p->n_objects; i++)
@@ -289,7 +477,11 @@ TYPE##_t* FNAME(world_t* w, float x, float y, __VA_ARGS__) \
 LOOKFOR(world_findMine,           mine,     if (obj->t != t)                          continue, kindOf_mine_t* t)
 LOOKFOR(world_findBuilding,       building, if (obj->t != t)                          continue, kindOf_building_t* t)
 LOOKFOR(world_findEnnemyBuilding, building, if (obj->owner == p->o.uuid)              continue, character_t* p)
-LOOKFOR(world_findSale,           building, if (building_onSale(obj,is_item,id) <= 0) continue, char is_item, int id)
+
+building_t* world_findSale(world_t* w, float x, float y, char is_item, int id, float amount)
+{
+	return market_find(&w->market, x, y, is_item, id, amount);
+}
 
 character_t* world_findEnnemyCharacter(world_t* w, character_t* c)
 {
@@ -346,12 +538,12 @@ char world_canMine(world_t* w, float x, float y)
 
 	return 1;
 }
-mine_t* world_addMine(world_t* w, float x, float y, kindOf_mine_t* t)
+mine_t* world_addMine(world_t* w, uuid_t uuid, float x, float y, kindOf_mine_t* t)
 {
 	if (!world_canMine(w, x, y))
 		return NULL;
 
-	mine_t* m = mine_new(&w->objects, -1);
+	mine_t* m = mine_new(&w->objects, uuid);
 	mine_init(m, w, t, x, y);
 
 	object_t o = m->o;
@@ -360,6 +552,7 @@ mine_t* world_addMine(world_t* w, float x, float y, kindOf_mine_t* t)
 	chunk_pushMine(world_chunkXY(w, o.x+o.w/2, o.y-o.h), m);
 	chunk_pushMine(world_chunkXY(w, o.x+o.w/2, o.y    ), m);
 
+	w->version++;
 	return m;
 }
 
@@ -415,6 +608,7 @@ building_t* world_addBuilding(world_t* w, float x, float y, kindOf_building_t* t
 	chunk_pushBuilding(world_chunkXY(w, o.x+o.w/2, o.y-o.h), b);
 	chunk_pushBuilding(world_chunkXY(w, o.x+o.w/2, o.y    ), b);
 
+	w->version++;
 	return b;
 }
 
@@ -425,6 +619,8 @@ void world_delBuilding(world_t* w, building_t* b)
 	chunk_delBuilding(world_chunkXY(w, o.x-o.w/2, o.y    ), o.uuid);
 	chunk_delBuilding(world_chunkXY(w, o.x+o.w/2, o.y-o.h), o.uuid);
 	chunk_delBuilding(world_chunkXY(w, o.x+o.w/2, o.y    ), o.uuid);
+	market_del(&w->market, b);
+	w->version++;
 
 	building_exit(b);
 	pool_t* p = &w->objects;
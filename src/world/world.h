@@ -21,7 +21,11 @@
 
 typedef struct world world_t;
 
+#include <stdio.h>
+
 #include "../settings.h"
+#include "../progress.h"
+#include "../rand.h"
 #include "../universe/universe.h"
 #include "chunk.h"
 #include "event.h"
@@ -29,9 +33,39 @@ typedef struct world world_t;
 #include "object.h"
 #include "building.h"
 #include "pool.h"
+#include "market.h"
+#include "aisched.h"
+
+// independent random streams, so that changing one use
+// does not alter the others
+typedef enum
+{
+	RNG_TERRAIN,
+	RNG_BIOMES,
+	RNG_MINES,
+	RNG_CHARACTERS,
+	RNG_AI,
+	RNG_STREAMS,
+} rng_stream_t;
 
 #define CHUNK(W,I,J) (&(W)->chunks[(I)*(W)->chunk_cols+(J)])
 
+// chunks keeping their tiles in memory in a streaming world
+#define WORLD_RESIDENT 256
+
+// chunks keeping their vertices, at least
+#define WORLD_MESHES 16
+
+// chunks keeping their texture, at least
+#define WORLD_BAKED 64
+
+typedef struct
+{
+	chunk_t* first; // most recently used
+	chunk_t* last;
+	size_t   n;
+} lru_list_t;
+
 struct world
 {
 	object_t o;
@@ -40,6 +74,8 @@ struct world
 	universe_t* universe;
 
 	unsigned int seed;
+	rng_t rng[RNG_STREAMS];
+	int generator;
 	int cols;
 	int rows;
 	int chunk_cols;
@@ -47,13 +83,35 @@ struct world
 	size_t n_chunks;
 	chunk_t* chunks;
 
+	// streaming world: chunks are generated when first used, and the
+	// least recently used ones are moved to a swap file; asked for
+	// before world_genmap(), which keeps it for local generators only
+	char  lazy;
+	FILE* swap;
+
+	// chunks by resource, and the number of meshes and
+	// textures kept, which depends on the size of the view
+	lru_list_t lru[LRU_LISTS];
+	size_t     max_meshes;
+	size_t     max_baked;
+
 	// on-going events
 	evtList_t events;
 
 	pool_t objects;
-};
 
-#include <stdio.h>
+	int          tick;    // rounds since start
+	unsigned int version; // bumped when mines or buildings are added or removed
+
+	// buildings with stock, by component
+	market_t market;
+
+	// time-sliced bot decisions
+	aisched_t sched;
+
+	// generation progress, or NULL
+	progress_t* progress;
+};
 
 #include "../game.h"
 
@@ -62,6 +120,15 @@ void world_exit(world_t* w);
 
 chunk_t* world_chunkXY(world_t* w, float x, float y);
 
+// make the tiles of a chunk available
+void world_touchChunk(world_t* w, chunk_t* c);
+
+// make the tiles and the vertices of a chunk available
+void world_showChunk(world_t* w, chunk_t* c);
+
+// mark the texture of a chunk as used, dropping the oldest ones
+void world_keepBaked(world_t* w, chunk_t* c);
+
 short* world_landXY   (world_t* w, float x, float y);
 short  world_getLandXY(world_t* w, float x, float y);
 void   world_setLandXY(world_t* w, float x, float y, short l);
@@ -69,6 +136,10 @@ short* world_landIJ   (world_t* w, int i, int j);
 short  world_getLandIJ(world_t* w, int i, int j);
 void   world_setLandIJ(world_t* w, int i, int j, short l);
 
+// change the land type of a tile, fixing the borders around; for
+// terraforming, not used by the game yet
+void   world_setTypeIJ(world_t* w, int i, int j, short t);
+
 void world_doRound(world_t* w, float duration);
 
 object_t* world_objectAt(world_t* w, float x, float y, object_t* ignore);
@@ -76,18 +147,18 @@ object_t* world_objectAt(world_t* w, float x, float y, object_t* ignore);
 mine_t*      world_findMine           (world_t* w, float x, float y, kindOf_mine_t* t);
 building_t*  world_findBuilding       (world_t* w, float x, float y, kindOf_building_t* t);
 building_t*  world_findEnnemyBuilding (world_t* w, float x, float y, character_t* c);
-building_t*  world_findSale           (world_t* w, float x, float y, char is_item, int id);
+building_t*  world_findSale           (world_t* w, float x, float y, char is_item, int id, float amount);
 character_t* world_findEnnemyCharacter(world_t* w, character_t* c);
 
-mine_t*     world_addMine     (world_t* w, float x, float y, kindOf_mine_t* t);
+mine_t*     world_addMine     (world_t* w, uuid_t uuid, float x, float y, kindOf_mine_t* t);
 
 char        world_canBuild    (world_t* w, float x, float y, kindOf_building_t* t);
 building_t* world_addBuilding (world_t* w, float x, float y, kindOf_building_t* t, character_t* c);
 void        world_delBuilding (world_t* w, building_t* b);
 
 // world_gen.c
-void world_genmap  (world_t* w, unsigned int seed);
+char world_genmap  (world_t* w, unsigned int seed); // 0 if cancelled or failed
+void world_genChunk(world_t* w, chunk_t* c);
 void world_start   (world_t* w);
-void world_randMine(world_t* w, int type);
 
 #endif
@@ -19,50 +19,226 @@
 #include "world.h"
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "../mem.h"
+#include "../jobs.h"
 #include "../rand.h"
 #include "../voronoi/lloyd.h"
+#include "chunkgen.h"
+#include "mapcache.h"
 
-void world_genmap(world_t* w, unsigned int seed)
+// biome radii are drawn below this bound
+#define BIOME_RADIUS 10
+
+// assign land types to regions, given their sites
+static void region_types(world_t* w, size_t n, point_t* sites, short* types)
 {
-	universe_t* u = w->universe;
+	static const float land_probas[] = {0, 0.25, 0.25, 0.2, 0.05, 0,0,0,0,0,0.25};
 
-	fprintf(stderr, "Using seed %#x\n", seed);
-	srand(seed);
-	w->seed = seed;
+	rng_t* r = &w->rng[RNG_BIOMES];
+	alias_t pick;
+	alias_init(&pick, sizeof(land_probas)/sizeof(float), land_probas);
 
-	if (w->settings->verbosity >= 1)
-		fprintf(stderr, "Proceeding to land generation\n");
+	for (size_t i = 0; i < n; i++)
+		types[i] = 0;
 
-	int cw = 64;
-	int ch = 64;
-	w->chunk_cols = ceil((float) w->cols / cw);
-	w->chunk_rows = ceil((float) w->rows / ch);
-	w->n_chunks = w->chunk_cols*w->chunk_rows;
-	w->chunks = CALLOC(chunk_t, w->n_chunks);
-	for (int i = 0; i < w->chunk_rows; i++)
-		for (int j = 0; j < w->chunk_cols; j++)
+	// bucket the sites in cells as large as a biome radius
+	int rows = w->rows / BIOME_RADIUS + 1;
+	int cols = w->cols / BIOME_RADIUS + 1;
+	size_t* start = CALLOC(size_t, rows*cols+1);
+	size_t* cell  = CALLOC(size_t, n);
+	size_t* index = CALLOC(size_t, n);
+	for (int k = 0; k <= rows*cols; k++)
+		start[k] = 0;
+	for (size_t k = 0; k < n; k++)
+	{
+		int i = sites[k].x / BIOME_RADIUS;
+		int j = sites[k].y / BIOME_RADIUS;
+		i = i < 0 ? 0 : i >= rows ? rows-1 : i;
+		j = j < 0 ? 0 : j >= cols ? cols-1 : j;
+		cell[k] = i*cols + j;
+		start[cell[k]+1]++;
+	}
+	for (int k = 0; k < rows*cols; k++)
+		start[k+1] += start[k];
+	for (size_t k = 0; k < n; k++)
+		index[start[cell[k]]++] = k;
+	for (int k = rows*cols; k > 0; k--)
+		start[k] = start[k-1];
+	start[0] = 0;
+	free(cell);
+
+	// later biomes overwrite earlier ones
+	size_t n_biomes = w->rows * w->cols / 1000;
+	for (size_t k = 0; k < n_biomes; k++)
+	{
+		int t = alias_pick(&pick, r);
+		float i = rng_float(r, 0, w->rows);
+		float j = rng_float(r, 0, w->cols);
+		float d = rng_float(r, 5, 10);
+		d *= d;
+
+		int ci = i / BIOME_RADIUS;
+		int cj = j / BIOME_RADIUS;
+		for (int a = ci-1; a <= ci+1; a++)
+		for (int b = cj-1; b <= cj+1; b++)
 		{
-			chunk_t* c = CHUNK(w, i, j);
-			float x = TILE_SIZE*cw*(j-.5*w->chunk_cols+.5);
-			float y = TILE_SIZE*ch*(i-.5*w->chunk_rows+.5+.5);
-			chunk_init(c, w, x, y, cw, ch);
+			if (a < 0 || a >= rows || b < 0 || b >= cols)
+				continue;
+			size_t c = a*cols + b;
+			for (size_t l = start[c]; l < start[c+1]; l++)
+			{
+				size_t k = index[l];
+				point_t p = point_minus((point_t){i,j}, sites[k]);
+				if (p.x*p.x + p.y*p.y < d)
+					types[k] = t;
+			}
 		}
+	}
 
-	if (w->settings->verbosity >= 1)
-		fprintf(stderr, "Prepared chunks\n");
+	free(index);
+	free(start);
+	alias_exit(&pick);
+}
 
-	w->cols = w->chunk_cols * cw;
-	w->rows = w->chunk_rows * ch;
+// tile rows per rasterisation job
+#define RASTER_GRAIN 64
 
-	w->o.t = O_WORLD;
-	w->o.w = w->cols * TILE_SIZE;
-	w->o.h = w->rows * TILE_SIZE;
-	w->o.x = 0;
-	w->o.y = w->o.h/2;
+typedef struct
+{
+	world_t* w;
+	vr_diagram_t* v;
+	short* types;
+
+	// range of tile rows covered by each region
+	int* top;
+	int* bottom;
+
+	// span of the current region on each row
+	double* lo;
+	double* hi;
+} rsjob_t;
 
-	// BEGIN land generation
+// set tiles j0 to j1 of the i-th row, chunk by chunk
+static void raster_span(world_t* w, int i, int j0, int j1, short t)
+{
+	int ch = w->chunks[0].rows;
+	int cw = w->chunks[0].cols;
+	chunk_t* c = CHUNK(w, i/ch, j0/cw);
+	short* row = &LAND(c, i%ch, 0);
+	int j = j0 % cw;
+	for (int k = j0; k <= j1; k++)
+	{
+		if (j == cw)
+		{
+			c++;
+			row = &LAND(c, i%ch, 0);
+			j = 0;
+		}
+		row[j++] = t;
+	}
+}
+
+// edge table fill of the convex regions over a band of rows
+static void raster_rows(void* arg, size_t first, size_t last)
+{
+	rsjob_t* job = (rsjob_t*) arg;
+	world_t* w = job->w;
+	vr_diagram_t* v = job->v;
+	double* lo = job->lo;
+	double* hi = job->hi;
+	for (size_t k = 0; k < v->n_regions; k++)
+	{
+		int top    = job->top[k]    <  (int) first ? (int) first  : job->top[k];
+		int bottom = job->bottom[k] >= (int) last  ? (int) last-1 : job->bottom[k];
+		if (top > bottom)
+			continue;
+
+		for (int i = top; i <= bottom; i++)
+		{
+			lo[i] = w->cols;
+			hi[i] = -1;
+		}
+
+		// each edge crosses the rows between its end points
+		vr_region_t* r = &v->regions[k];
+		for (size_t l = 0; l < r->n_edges; l++)
+		{
+			const point_t* a = r->edges[l]->s.a;
+			const point_t* b = r->edges[l]->s.b;
+			if (a->x > b->x)
+			{
+				const point_t* t = a; a = b; b = t;
+			}
+			int i0 = ceil(a->x);
+			int i1 = floor(b->x);
+			if (i0 < top)    i0 = top;
+			if (i1 > bottom) i1 = bottom;
+			for (int i = i0; i <= i1; i++)
+			{
+				double y0 = a->y;
+				double y1 = b->y;
+				if (a->x != b->x)
+					y0 = y1 = a->y + (i - a->x) * (b->y - a->y) / (b->x - a->x);
+				if (y0 > y1)
+				{
+					double t = y0; y0 = y1; y1 = t;
+				}
+				if (y0 < lo[i]) lo[i] = y0;
+				if (y1 > hi[i]) hi[i] = y1;
+			}
+		}
+
+		short t = 16 * job->types[k];
+		for (int i = top; i <= bottom; i++)
+		{
+			if (lo[i] > hi[i])
+				continue;
+			int j0 = lo[i] < 0 ? 0 : floor(lo[i]);
+			int j1 = hi[i] >= w->cols ? w->cols-1 : floor(hi[i]);
+			if (j0 <= j1)
+				raster_span(w, i, j0, j1, t);
+		}
+	}
+}
+
+// set the tiles of each region, later regions overwriting earlier ones
+static void raster(world_t* w, vr_diagram_t* v, short* types)
+{
+	int* top    = CALLOC(int, v->n_regions);
+	int* bottom = CALLOC(int, v->n_regions);
+	for (size_t k = 0; k < v->n_regions; k++)
+	{
+		vr_region_t* r = &v->regions[k];
+		double min = w->rows;
+		double max = -1;
+		for (size_t l = 0; l < r->n_edges; l++)
+		{
+			segment_t* s = &r->edges[l]->s;
+			if (s->a->x < min) min = s->a->x;
+			if (s->a->x > max) max = s->a->x;
+			if (s->b->x < min) min = s->b->x;
+			if (s->b->x > max) max = s->b->x;
+		}
+		top[k]    = min < 0 ? 0 : ceil(min);
+		bottom[k] = max >= w->rows ? w->rows-1 : floor(max);
+	}
+
+	double* lo = CALLOC(double, w->rows);
+	double* hi = CALLOC(double, w->rows);
+	rsjob_t job = {w, v, types, top, bottom, lo, hi};
+	jobs_for("raster", w->rows, RASTER_GRAIN, raster_rows, &job);
+	free(hi);
+	free(lo);
+	free(bottom);
+	free(top);
+}
+
+// returns 0 if cancelled
+static char land_voronoi(world_t* w)
+{
 	// generate Voronoi diagram
 	if (w->settings->verbosity >= 3)
 		fprintf(stderr, "Initialiazing Voronoi diagram\n");
@@ -71,151 +247,560 @@ void world_genmap(world_t* w, unsigned int seed)
 	size_t n_vrPoints = w->rows * w->cols / 50;
 	for (size_t i = 0; i < n_vrPoints; i++)
 	{
-		double i = frnd(0, w->rows);
-		double j = frnd(0, w->cols);
+		double i = rng_float(&w->rng[RNG_TERRAIN], 0, w->rows);
+		double j = rng_float(&w->rng[RNG_TERRAIN], 0, w->cols);
 		vr_diagram_point(&v, (point_t){i,j});
 	}
 	for (int i = 1; i <= 2; i++)
 	{
+		if (!progress_set(w->progress, PROGRESS_LAND, (i-1) / 4.f))
+		{
+			vr_diagram_exit(&v);
+			return 0;
+		}
 		if (w->settings->verbosity >= 3)
 			fprintf(stderr, "Lloyd relexation pass %i\n", i);
 		vr_lloyd_relaxation(&v);
 	}
+	if (!progress_set(w->progress, PROGRESS_LAND, 0.5))
+	{
+		vr_diagram_exit(&v);
+		return 0;
+	}
 	vr_diagram_end(&v);
 	if (w->settings->verbosity >= 3)
 		fprintf(stderr, "Finished Voronoi generation\n");
 
 	// assign land types to Voronoi regions
-	static const float land_probas[] = {0, 0.25, 0.25, 0.2, 0.05, 0,0,0,0,0,0.25};
-
-	short region_types[v.n_regions];
+	point_t* sites = CALLOC(point_t, v.n_regions);
 	for (size_t i = 0; i < v.n_regions; i++)
-		region_types[i] = 0;
+		sites[i] = v.regions[i].p;
+	short* types = CALLOC(short, v.n_regions);
+	region_types(w, v.n_regions, sites, types);
+	free(sites);
 
-	size_t n_biomes = w->rows * w->cols / 1000;
-	for (size_t k = 0; k < n_biomes; k++)
+	// rasterise map
+	progress_set(w->progress, PROGRESS_LAND, 0.75);
+	raster(w, &v, types);
+
+	free(types);
+	vr_diagram_exit(&v);
+	if (w->settings->verbosity >= 3)
+		fprintf(stderr, "Rasterization done\n");
+	return 1;
+}
+
+// tile rows per jump flooding job
+#define JUMPFLOOD_GRAIN 32
+
+typedef struct
+{
+	world_t* w;
+	point_t* sites;
+	int* dst;
+	const int* src;
+	int step;
+} jfjob_t;
+
+// one pass of jump flooding at the given step
+static void jumpflood_rows(void* arg, size_t first, size_t last)
+{
+	jfjob_t* job = (jfjob_t*) arg;
+	point_t* sites = job->sites;
+	const int* src = job->src;
+	int step = job->step;
+	int rows = job->w->rows;
+	int cols = job->w->cols;
+	for (int i = first; i < (int) last; i++)
+	for (int j = 0; j < cols; j++)
 	{
-		int t = rnd_pick(land_probas);
-		float i = frnd(0, w->rows);
-		float j = frnd(0, w->cols);
-		float d = frnd(5, 10);
-		d *= d;
-		for (size_t k = 0; k < v.n_regions; k++)
+		int best = src[i*cols+j];
+		double best_d = 0;
+		if (best >= 0)
+		{
+			double dx = sites[best].x - i;
+			double dy = sites[best].y - j;
+			best_d = dx*dx + dy*dy;
+		}
+
+		for (int ni = i-step; ni <= i+step; ni += step)
 		{
-			vr_region_t* r = v.regions[k];
-			point_t p = point_minus((point_t){i,j}, r->p);
-			if (p.x*p.x + p.y*p.y < d)
-				region_types[k] = t;
+			if (ni < 0 || ni >= rows)
+				continue;
+			for (int nj = j-step; nj <= j+step; nj += step)
+			{
+				if (nj < 0 || nj >= cols)
+					continue;
+
+				int l = src[ni*cols+nj];
+				if (l < 0 || l == best)
+					continue;
+
+				double dx = sites[l].x - i;
+				double dy = sites[l].y - j;
+				double d = dx*dx + dy*dy;
+				if (best < 0 || d < best_d)
+				{
+					best = l;
+					best_d = d;
+				}
+			}
 		}
+		job->dst[i*cols+j] = best;
 	}
+}
+static void jumpflood_pass(world_t* w, point_t* sites, int* dst, const int* src, int step)
+{
+	jfjob_t job = {w, sites, dst, src, step};
+	jobs_for("jumpflood", w->rows, JUMPFLOOD_GRAIN, jumpflood_rows, &job);
+}
 
-	// rasterise map
-	// TODO: clean that thing
-	// yes, I know, this is the single most ugly and horrible
-	// batch of code of this project; however, getting pixels
-	// from a polygon is not totally trivial; to be cleaned later
-	for (size_t i = 0; i < v.n_regions; i++)
+// label each tile with its nearest site
+static void jumpflood(world_t* w, size_t n, point_t* sites, int* label, int* tmp)
+{
+	int rows = w->rows;
+	int cols = w->cols;
+
+	// sites are spread evenly, so there is no need to start with a
+	// step as large as the map; it is enlarged if tiles are left out
+	int first = 1;
+	while (first*first < 4 * rows*cols / (int) (n+1))
+		first *= 2;
+
+	while (1)
 	{
-		short t = 16 * region_types[i];
+		for (int k = 0; k < rows*cols; k++)
+			label[k] = -1;
 
-		// set tiles in the i-th Voronoi region to proper type
+		// seed the tiles holding a site
+		for (size_t k = 0; k < n; k++)
+		{
+			int i = sites[k].x;
+			int j = sites[k].y;
+			if (0 <= i && i < rows && 0 <= j && j < cols)
+				label[i*cols+j] = k;
+		}
 
-		// first, get vertical bounds on the region
-		vr_region_t* r = v.regions[i];
-		int minj = w->cols;
-		int maxj = 0;
-		for (size_t k = 0; k < r->n_edges; k++)
+		// an additional pass of step one fixes most errors
+		int* src = label;
+		int* dst = tmp;
+		for (int step = first; step >= 1; step /= 2)
 		{
-			segment_t* s = &r->edges[k]->s;
-			if (s->a->y < minj) minj = floor(s->a->y);
-			if (s->a->y > maxj) maxj = floor(s->a->y);
-			if (s->b->y < minj) minj = floor(s->b->y);
-			if (s->b->y > maxj) maxj = floor(s->b->y);
+			jumpflood_pass(w, sites, dst, src, step);
+			int* t = src; src = dst; dst = t;
 		}
-		if (maxj >= w->cols)
-			maxj = w->cols - 1;
+		jumpflood_pass(w, sites, dst, src, 1);
+
+		if (dst != label)
+			memcpy(label, dst, sizeof(int)*rows*cols);
+
+		char done = 1;
+		for (int k = 0; done && k < rows*cols; k++)
+			done = label[k] >= 0;
+		if (done || (first >= rows && first >= cols))
+			break;
+		first *= 2;
+	}
+}
+
+// discrete Voronoi regions on the tile grid; returns 0 if cancelled
+static char land_jumpflood(world_t* w)
+{
+	if (w->settings->verbosity >= 3)
+		fprintf(stderr, "Initialiazing jump flood\n");
+
+	int rows = w->rows;
+	int cols = w->cols;
+	size_t n = rows * cols / 50;
+	point_t* sites = CALLOC(point_t, n);
+	for (size_t i = 0; i < n; i++)
+	{
+		double x = rng_float(&w->rng[RNG_TERRAIN], 0, rows);
+		double y = rng_float(&w->rng[RNG_TERRAIN], 0, cols);
+		sites[i] = (point_t){x,y};
+	}
+
+	int* label = CALLOC(int, rows*cols);
+	int* tmp   = CALLOC(int, rows*cols);
+
+	// Lloyd relaxation, with centroids of the labelled tiles
+	double* sum = CALLOC(double, 3*n);
+	for (int pass = 1; pass <= 2; pass++)
+	{
+		if (!progress_set(w->progress, PROGRESS_LAND, (pass-1) / 4.f))
+			break;
+		if (w->settings->verbosity >= 3)
+			fprintf(stderr, "Lloyd relexation pass %i\n", pass);
+		jumpflood(w, n, sites, label, tmp);
 
-		// then, consider each so-selected slide row
-		for (int j = minj; j <= maxj; j++)
+		for (size_t k = 0; k < 3*n; k++)
+			sum[k] = 0;
+		for (int i = 0; i < rows; i++)
+		for (int j = 0; j < cols; j++)
 		{
-			// find the portion of the row in the region
-			int mini = w->rows;
-			int maxi = 0;
-			point_t a = {mini, j};
-			point_t b = {maxi, j};
-			segment_t s = {&a, &b};
-			for (size_t k = 0; k < r->n_edges; k++)
-			{
-				point_t p;
-				if (!segment_intersect(&p, &s, &r->edges[k]->s))
-					continue;
-				if (p.x < mini)
-					mini = floor(p.x);
-				if (p.x > maxi)
-					maxi = floor(p.x);
-			}
-			if (maxi >= w->rows)
-				maxi = w->rows - 1;
+			double* s = &sum[3*label[i*cols+j]];
+			s[0] += i;
+			s[1] += j;
+			s[2] += 1;
+		}
 
-			// set this portion to proper type
-			for (int i = mini; i <= maxi; i++)
-				world_setLandIJ(w, i, j, t);
+		// keep the order of the sites
+		size_t k = 0;
+		for (size_t l = 0; l < n; l++)
+		{
+			double* s = &sum[3*l];
+			if (s[2] != 0)
+				sites[k++] = (point_t){s[0]/s[2], s[1]/s[2]};
 		}
+		n = k;
+	}
+	free(sum);
+	if (!progress_set(w->progress, PROGRESS_LAND, 0.5))
+	{
+		free(tmp);
+		free(label);
+		free(sites);
+		return 0;
 	}
+	jumpflood(w, n, sites, label, tmp);
+	free(tmp);
+	if (w->settings->verbosity >= 3)
+		fprintf(stderr, "Finished jump flood\n");
 
-	vr_diagram_exit(&v);
+	progress_set(w->progress, PROGRESS_LAND, 0.75);
+	short* types = CALLOC(short, n);
+	region_types(w, n, sites, types);
+	free(sites);
+
+	for (int i = 0; i < rows; i++)
+	for (int j = 0; j < cols; j++)
+		world_setLandIJ(w, i, j, 16 * types[label[i*cols+j]]);
+
+	free(types);
+	free(label);
 	if (w->settings->verbosity >= 3)
 		fprintf(stderr, "Rasterization done\n");
-	// END land generation
-
-	// BEGIN region borders
-#define LAND_TYPE(I,J) (world_getLandIJ(w,I,J) / 16)
-#define LAND_SAME(I,J) ( \
-	((I) < 0 || (I) >= w->rows || (J) < 0 || (J) >= w->cols) ? \
-	1 : \
-	t == LAND_TYPE(I,J) \
-)
-	static const char type2tile[16] = {0,5,2,13,4,7,12,8,3,15,6,11,14,9,10,1};
-	for (int i = 0; i < w->rows; i++)
-	for (int j = 0; j < w->cols; j++)
-	{
-		int t = LAND_TYPE(i,j);
-		if (t == 0)
+	return 1;
+}
+
+// tile rows per border fixing job
+#define AUTOTILE_GRAIN 64
+
+typedef struct
+{
+	world_t* w;
+
+	// land types with a one tile margin copying the map borders
+	const short* type;
+} atjob_t;
+
+// pick border tiles from the types of the 4-neighbours
+static void autotile_rows(void* arg, size_t first, size_t last)
+{
+	atjob_t* job = (atjob_t*) arg;
+	world_t* w = job->w;
+	int cols = w->cols;
+	int ch = w->chunks[0].rows;
+	int cw = w->chunks[0].cols;
+	for (int i = first; i < (int) last; i++)
+	{
+		const short* row = &job->type[(i+1)*(cols+2) + 1];
+		for (int cj = 0; cj < w->chunk_cols; cj++)
+			chunkgen_borders(&LAND(CHUNK(w, i/ch, cj), i%ch, 0), &row[cj*cw], cols+2, cw);
+	}
+}
+
+// turn region boundaries into proper border tiles
+static void autotile(world_t* w)
+{
+	int rows = w->rows;
+	int cols = w->cols;
+	int ch = w->chunks[0].rows;
+	int cw = w->chunks[0].cols;
+
+	// copy the types to a separate grid, since tiles are overwritten
+	short* type = CALLOC(short, (rows+2)*(cols+2));
+	for (int i = 0; i < rows; i++)
+	{
+		short* row = &type[(i+1)*(cols+2) + 1];
+		for (int cj = 0; cj < w->chunk_cols; cj++)
+		{
+			const short* src = &LAND(CHUNK(w, i/ch, cj), i%ch, 0);
+			for (int j = 0; j < cw; j++)
+				row[cj*cw + j] = src[j] / 16;
+		}
+		row[-1]   = row[0];
+		row[cols] = row[cols-1];
+	}
+	memcpy(type, type + (cols+2), sizeof(short)*(cols+2));
+	memcpy(type + (rows+1)*(cols+2), type + rows*(cols+2), sizeof(short)*(cols+2));
+
+	atjob_t job = {w, type};
+	jobs_for("autotile", rows, AUTOTILE_GRAIN, autotile_rows, &job);
+	free(type);
+}
+
+// generate chunks of a chunk-local generator, borders included
+static void chunkgen_range(void* arg, size_t first, size_t last)
+{
+	world_t* w = (world_t*) arg;
+	for (size_t i = first; i < last; i++)
+	{
+		if (!progress_set(w->progress, PROGRESS_LAND, (float) i / w->n_chunks))
+			return;
+		chunk_t* c = &w->chunks[i];
+		if (w->generator == WORLD_GEN_NOISE)
+			chunkgen_noise(w, c);
+		else
+			chunkgen_cells(w, c);
+	}
+}
+
+static char land_chunks(world_t* w)
+{
+	jobs_for("chunkgen", w->n_chunks, 1, chunkgen_range, w);
+	return !progress_cancelled(w->progress);
+}
+
+// mines must not lie on mountains or water
+static char mine_land(short l)
+{
+	l /= 16;
+	return l != 4 && l != 10;
+}
+
+// place up to n mines with Poisson disk sampling over the tiles of the
+// given rectangle where they fit; if 'each' is set, the first ones are
+// of each type in turn; the others are picked by probability; mines get
+// uuids from 'first' on, or the next free ones if it is -1; returns the
+// number of mines placed
+static size_t place_mines(world_t* w, rng_t* r, int top, int left, int rows, int cols, size_t n, char each, uuid_t first)
+{
+	static const float mine_probas[] = {0.22,0.22,0.20,0.10,0.08,0.06,0.06,0.06};
+	universe_t* u = w->universe;
+
+	// a mine at tile (i,j) covers tiles i to i+2 and j to j+2
+	char* fit = CALLOC(char, rows*cols);
+	for (int i = 0; i < rows; i++)
+	for (int j = 0; j < cols; j++)
+		fit[i*cols+j] = mine_land(world_getLandIJ(w, top+i, left+j));
+	for (int i = 0; i < rows; i++)
+	for (int j = 0; j < cols; j++)
+		fit[i*cols+j] = j+2 < cols && fit[i*cols+j] && fit[i*cols+j+1] && fit[i*cols+j+2];
+	for (int i = 0; i < rows; i++)
+	for (int j = 0; j < cols; j++)
+		fit[i*cols+j] = i+2 < rows && fit[i*cols+j] && fit[(i+1)*cols+j] && fit[(i+2)*cols+j];
+
+	size_t n_candidates = 0;
+	int* candidates = CALLOC(int, rows*cols);
+	for (int k = 0; k < rows*cols; k++)
+		if (fit[k])
+			candidates[n_candidates++] = k;
+	free(fit);
+
+	// shuffle the candidates, then keep those far enough from the others
+	for (size_t k = n_candidates; k > 1; k--)
+	{
+		size_t l = rng_int(r, k);
+		int t = candidates[k-1];
+		candidates[k-1] = candidates[l];
+		candidates[l] = t;
+	}
+
+	// a cell of the background grid holds at most one mine
+	float radius = sqrtf((float) rows*cols / (n+1)) / 2;
+	if (radius < 2)
+		radius = 2;
+	float cell = radius / sqrtf(2);
+	int grows = rows / cell + 1;
+	int gcols = cols / cell + 1;
+	int* grid = CALLOC(int, grows*gcols);
+	for (int k = 0; k < grows*gcols; k++)
+		grid[k] = -1;
+
+	alias_t pick;
+	alias_init(&pick, sizeof(mine_probas)/sizeof(float), mine_probas);
+
+	// the second pass only ensures there are enough mines
+	size_t n_placed = 0;
+	for (int pass = 0; pass < 2 && n_placed < n; pass++)
+	for (size_t k = 0; k < n_candidates && n_placed < n; k++)
+	{
+		int c = candidates[k];
+		if (c < 0)
+			continue;
+		int i = c / cols;
+		int j = c % cols;
+		int gi = i / cell;
+		int gj = j / cell;
+
+		char far = 1;
+		for (int a = gi-2; far && a <= gi+2; a++)
+		for (int b = gj-2; far && b <= gj+2; b++)
+		{
+			if (pass > 0 || a < 0 || a >= grows || b < 0 || b >= gcols)
+				continue;
+			int o = grid[a*gcols+b];
+			if (o < 0)
+				continue;
+			int di = o/cols - i;
+			int dj = o%cols - j;
+			far = di*di + dj*dj >= radius*radius;
+		}
+		if (!far)
 			continue;
-		char top    = LAND_SAME(i-1,j);
-		char right  = LAND_SAME(i,j+1);
-		char bottom = LAND_SAME(i+1,j);
-		char left   = LAND_SAME(i,j-1);
-		int neighbor = (top<<3) | (right<<2) | (bottom<<1) | (left<<0);
-		world_setLandIJ(w, i, j, 16*t + type2tile[neighbor]);
+
+		int type = each && n_placed < u->n_mines ? (int) n_placed : alias_pick(&pick, r);
+		float x = TILE_SIZE*(left+j+1) - w->o.w/2 + rng_float(r, 0, TILE_SIZE-1);
+		float y = TILE_SIZE*(top +i+2) - w->o.h/2 + rng_float(r, 0, TILE_SIZE-1);
+		uuid_t uuid = first < 0 ? -1 : first + (uuid_t) n_placed;
+		if (world_addMine(w, uuid, x, y, &u->mines[type]) == NULL)
+			continue;
+
+		grid[gi*gcols+gj] = c;
+		candidates[k] = -1;
+		n_placed++;
 	}
-	if (w->settings->verbosity >= 3)
-		fprintf(stderr, "Fixed region borders\n");
-	// END region borders
+	alias_exit(&pick);
+	free(grid);
+	free(candidates);
+	return n_placed;
+}
 
-	for (size_t i = 0; i < w->n_chunks; i++)
-		chunk_update(&w->chunks[i]);
+// the number of mines placed in a streamed chunk
+static size_t chunk_mines(chunk_t* c)
+{
+	return c->rows*c->cols * TILE_SIZE*TILE_SIZE / 100000;
+}
 
-	if (w->settings->verbosity >= 3)
-		fprintf(stderr, "Chunk generated\n");
+char world_genmap(world_t* w, unsigned int seed)
+{
+	universe_t* u = w->universe;
+
+	fprintf(stderr, "Using seed %#x\n", seed);
+	w->seed = seed;
+	for (int k = 0; k < RNG_STREAMS; k++)
+		rng_seed(&w->rng[k], seed, k);
+
+	if (w->settings->verbosity >= 1)
+		fprintf(stderr, "Proceeding to land generation\n");
+	progress_set(w->progress, PROGRESS_CHUNKS, 0);
+
+	int cw = 64;
+	int ch = 64;
+	w->lazy = w->lazy && WORLD_GEN_LOCAL(w->generator);
+	w->chunk_cols = ceil((float) w->cols / cw);
+	w->chunk_rows = ceil((float) w->rows / ch);
+	w->n_chunks = w->chunk_cols*w->chunk_rows;
+	w->chunks = CALLOC(chunk_t, w->n_chunks);
+	for (int i = 0; i < w->chunk_rows; i++)
+		for (int j = 0; j < w->chunk_cols; j++)
+		{
+			chunk_t* c = CHUNK(w, i, j);
+			float x = TILE_SIZE*cw*(j-.5*w->chunk_cols+.5);
+			float y = TILE_SIZE*ch*(i-.5*w->chunk_rows+.5+.5);
+			chunk_init(c, w, x, y, cw, ch);
+		}
+
+	// each streamed chunk has its range of uuids for its mines, so
+	// they do not depend on the order in which chunks are touched
+	if (w->lazy)
+		pool_reserve(&w->objects, w->n_chunks * chunk_mines(w->chunks));
+
+	if (w->settings->verbosity >= 1)
+		fprintf(stderr, "Prepared chunks\n");
+
+	w->cols = w->chunk_cols * cw;
+	w->rows = w->chunk_rows * ch;
+
+	w->o.t = O_WORLD;
+	w->o.w = w->cols * TILE_SIZE;
+	w->o.h = w->rows * TILE_SIZE;
+	w->o.x = 0;
+	w->o.y = w->o.h/2;
 
+	// from here, a cancelled world can be given to world_exit()
 	evtList_init(&w->events);
+	market_init(&w->market, w);
+
+	// a cached map skips generation entirely; a streaming
+	// one generates its chunks through world_touchChunk()
+	char cached = w->lazy || (w->settings->map_cache && mapcache_load(w));
+
+	if (!cached)
+	{
+		// BEGIN land generation
+		if (!progress_set(w->progress, PROGRESS_LAND, 0))
+			return 0;
+		char done =
+			WORLD_GEN_LOCAL(w->generator)       ? land_chunks(w)    :
+			w->generator == WORLD_GEN_JUMPFLOOD ? land_jumpflood(w) :
+			                                      land_voronoi(w);
+		if (!done)
+			return 0;
+		// END land generation
+
+		// BEGIN region borders
+		if (!progress_set(w->progress, PROGRESS_BORDERS, 0))
+			return 0;
+		if (!WORLD_GEN_LOCAL(w->generator))
+			autotile(w);
+		if (w->settings->verbosity >= 3)
+			fprintf(stderr, "Fixed region borders\n");
+		// END region borders
+	}
 
-	// BEGIN mine generation
-	size_t n_mines = w->o.w*w->o.h / 100000;
-	if (n_mines < u->n_mines)
-		n_mines = u->n_mines;
-	static const float mine_probas[] = {0.22,0.22,0.20,0.10,0.08,0.06,0.06,0.06};
-	for (size_t i = 0; i < u->n_mines; i++) // ensure there is at least one of each
-		world_randMine(w, i);
-	for (size_t i = u->n_mines; i < n_mines; i++)
-		world_randMine(w, rnd_pick(mine_probas));
-	// END mine generation
 	if (w->settings->verbosity >= 3)
-		fprintf(stderr, "Generated %u mines\n", (unsigned) n_mines);
+		fprintf(stderr, "Chunk generated\n");
+
+	if (!cached)
+	{
+		// BEGIN mine generation
+		if (!progress_set(w->progress, PROGRESS_MINES, 0))
+			return 0;
+		size_t n_mines = w->o.w*w->o.h / 100000;
+		if (n_mines < u->n_mines)
+			n_mines = u->n_mines;
+		n_mines = place_mines(w, &w->rng[RNG_MINES], 0, 0, w->rows, w->cols, n_mines, 1, -1);
+		if (n_mines < u->n_mines)
+		{
+			progress_fail(w->progress, "Could not place a mine of each type");
+			return 0;
+		}
+		// END mine generation
+		if (w->settings->verbosity >= 3)
+			fprintf(stderr, "Generated %u mines\n", (unsigned) n_mines);
+
+		if (w->settings->map_cache == MAP_CACHE_WRITE)
+			mapcache_save(w);
+	}
 
 	if (w->settings->verbosity >= 1)
 		fprintf(stderr, "Map is ready\n");
+	if (w->settings->verbosity >= 3)
+		jobs_report(stderr);
+	return 1;
+}
+
+void world_genChunk(world_t* w, chunk_t* c)
+{
+	if (w->generator == WORLD_GEN_NOISE)
+		chunkgen_noise(w, c);
+	else
+		chunkgen_cells(w, c);
+
+	// mines are objects, they stay when the chunk is swapped out
+	if (c->generated)
+		return;
+	c->generated = 1;
+
+	int ci = (c - w->chunks) / w->chunk_cols;
+	int cj = (c - w->chunks) % w->chunk_cols;
+	rng_t r;
+	chunkgen_rng(w, &r, ci, cj, CHUNKGEN_MINES);
+	size_t n = chunk_mines(c);
+	uuid_t first = (c - w->chunks) * n;
+	place_mines(w, &r, ci*c->rows, cj*c->cols, c->rows, c->cols, n, 0, first);
 }
 
 void world_start(world_t* w)
@@ -229,24 +814,13 @@ void world_start(world_t* w)
 	{
 		character_t* c = character_new(p, -1);
 
-		int type = rand() % u->n_characters;
+		int type = rng_int(&w->rng[RNG_CHARACTERS], u->n_characters);
 		character_init(c, w, &u->characters[type]);
-		character_setPosition(c, cfrnd(w->o.w-20), cfrnd(w->o.h-20));
+		float x = rng_cfloat(&w->rng[RNG_CHARACTERS], w->o.w-20);
+		float y = rng_cfloat(&w->rng[RNG_CHARACTERS], w->o.h-20);
+		character_setPosition(c, x, y);
 	}
 	if (w->settings->verbosity >= 3)
 		fprintf(stderr, "Generated %u characters\n", (unsigned) n_characters);
 	// END character generation
 }
-
-void world_randMine(world_t* w, int type)
-{
-	kindOf_mine_t* t = &w->universe->mines[type];
-	while (1)
-	{
-		float x = cfrnd(w->o.w - 32);
-		float y = cfrnd(w->o.h - 32) + 16;
-
-		if (world_addMine(w, x, y, t) != NULL)
-			break;
-	}
-}